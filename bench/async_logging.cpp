@@ -0,0 +1,139 @@
+#include "decorator.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// The text path the decorators used before: date check, operator<< and endl
+class TextLog {
+    public:
+        explicit TextLog(const std::string& path) : path_(path) {
+            file_.open(path_, std::ios::app);
+        }
+
+        void quote(Exchange venue, Token base, Token quote, const BBO& bbo) {
+            if (dateChanged()) {
+                file_.close();
+                file_.open(path_, std::ios::trunc);
+            }
+            PairScale scale = scaleOf(base, quote);
+            file_ << "[" << std::time(nullptr) << "] "
+                  << venue << " " << base << quote
+                  << " Bid: " << scale.price(bbo.bid.price) << "@" << scale.size(bbo.bid.size)
+                  << " Ask: " << scale.price(bbo.ask.price) << "@" << scale.size(bbo.ask.size)
+                  << std::endl;
+        }
+
+    private:
+        std::string path_;
+        std::ofstream file_;
+        std::string lastDate_;
+
+        bool dateChanged() {
+            time_t now = std::time(nullptr);
+            struct tm* timeinfo = std::localtime(&now);
+            std::ostringstream oss;
+            oss << (1900 + timeinfo->tm_year)
+                << std::setfill('0') << std::setw(2) << (timeinfo->tm_mon + 1)
+                << std::setfill('0') << std::setw(2) << timeinfo->tm_mday;
+            std::string date = oss.str();
+            if (date != lastDate_) {
+                lastDate_ = date;
+                return true;
+            }
+            return false;
+        }
+};
+
+// Answers from memory, so only the decorator's own cost is timed
+class StubGateway : public Gateway {
+    public:
+        StubGateway() { name = Exchange::BINANCE; }
+        BBO getBBO(Token, Token) override {
+            return BBO{PriceLevel{965081000, 52010000}, PriceLevel{965081100, 25730000}, 1737043526442};
+        }
+        std::string getTicker(Token&, Token&) override { return "BTCUSDC"; }
+};
+
+template<typename Call>
+static double nanosPerCall(int iterations, Call&& call) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        call();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+/**
+* Cost each quote log adds on the calling thread: the old ofstream + endl
+* text path against AsyncLogger, alone and behind LoggingDecorator on a
+* gateway that answers from memory, plus the async path with several
+* threads logging at once. Files go to a temporary directory.
+* usage: bench_async_logging [iterations=200000] [threads=4]
+*/
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 4;
+
+    char directory[] = "/tmp/cexa_logs_XXXXXX";
+    if (!mkdtemp(directory)) {
+        std::cerr << "[ERROR] Cannot create a temporary directory" << std::endl;
+        return 1;
+    }
+
+    const BBO bbo{PriceLevel{965081000, 52010000}, PriceLevel{965081100, 25730000}, 1737043526442};
+    AsyncLogger logger(directory);
+    TextLog text(std::string(directory) + "/exchange_logs.txt");
+
+    double textNs = nanosPerCall(iterations, [&]() { text.quote(Exchange::BINANCE, Token::BTC, Token::USDC, bbo); });
+
+    // below the ring capacity, so nothing is dropped while timing
+    int batch = static_cast<int>(AsyncLogger::CAPACITY / 2);
+    double asyncNs = 0;
+    for (int done = 0; done < iterations; done += batch) {
+        int n = std::min(batch, iterations - done);
+        asyncNs += nanosPerCall(n, [&]() { logger.quote(Exchange::BINANCE, Token::BTC, Token::USDC, bbo); }) * n;
+        logger.flush();
+    }
+    asyncNs /= iterations;
+
+    StubGateway* stub = new StubGateway();
+    LoggingDecorator decorated(stub, logger);
+    double bareNs = nanosPerCall(batch, [&]() { stub->getBBO(Token::BTC, Token::USDC); });
+    double decoratedNs = nanosPerCall(batch, [&]() { decorated.getBBO(Token::BTC, Token::USDC); });
+    logger.flush();
+
+    uint64_t dropped = logger.dropped();
+    std::vector<std::thread> producers;
+    int perThread = batch / std::max(threads, 1);
+    auto start = Clock::now();
+    for (int t = 0; t < threads; t++) {
+        producers.emplace_back([&]() {
+            for (int i = 0; i < perThread; i++) {
+                logger.quote(Exchange::BYBIT, Token::ETH, Token::USDT, bbo);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    double contendedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / perThread;
+    logger.flush();
+
+    std::cout << "text log ns / quote            : " << textNs << "\n"
+              << "async log ns / quote           : " << asyncNs << "\n"
+              << "getBBO ns, bare / logged       : " << bareNs << " / " << decoratedNs << "\n"
+              << "async ns / quote, " << threads << " threads    : " << contendedNs << "\n"
+              << "dropped                        : " << logger.dropped() - dropped << "\n"
+              << "logs in                        : " << directory << "\n";
+    return 0;
+}
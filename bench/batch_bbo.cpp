@@ -0,0 +1,123 @@
+#include "local_server.hpp"
+#include "bybit/ByBitGateway.cpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const std::vector<Token> TOKENS = {Token::BTC, Token::ETH, Token::USDC, Token::USDT};
+
+// One /market/tickers?category=spot entry, shaped like the venue's
+static std::string tickerEntry(const std::string& symbol, int i) {
+    return R"({"symbol":")" + symbol + R"(","bid1Price":")" + std::to_string(100 + i) + R"(.1","bid1Size":"0.52",)"
+        R"("ask1Price":")" + std::to_string(100 + i) + R"(.2","ask1Size":"0.25","lastPrice":"100.15",)"
+        R"("prevPrice24h":"99.8","price24hPcnt":"0.0035","highPrice24h":"101.2","lowPrice24h":"98.7",)"
+        R"("turnover24h":"12345678.9","volume24h":"123456.78","usdIndexPrice":"100.14"})";
+}
+
+// The whole spot list: every pair the bot can ask for plus filler symbols
+static std::string tickersPayload(int filler) {
+    std::string body = R"({"retCode":0,"retMsg":"OK","result":{"category":"spot","list":[)";
+    int n = 0;
+    for (Token base : TOKENS) {
+        for (Token quote : TOKENS) {
+            if (base == quote) continue;
+            std::stringstream ss;
+            ss << base << quote;
+            body += (n ? "," : "") + tickerEntry(ss.str(), n);
+            n++;
+        }
+    }
+    for (int i = 0; i < filler; i++, n++) {
+        body += "," + tickerEntry("ALT" + std::to_string(i) + "USDT", n);
+    }
+    return body + R"(]},"retExtInfo":{},"time":1737043526579})";
+}
+
+static const char* DEPTH_PAYLOAD =
+    R"({"retCode":0,"retMsg":"OK","result":{"s":"BTCUSDC","a":[["96508.2","0.080542"]],)"
+    R"("b":[["96508.1","0.370386"]],"ts":1737043526442,"u":2876924,"seq":47135468392,"cts":1737043526438},)"
+    R"("retExtInfo":{},"time":1737043526579})";
+
+// The per pair fan out the base Gateway does for venues without a bulk endpoint
+class FanOutByBitGateway : public ByBitGateway {
+    public:
+        using ByBitGateway::ByBitGateway;
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            return Gateway::getBBOsAsync(instruments);
+        }
+};
+
+template<typename Fetch>
+static double scanMicros(int scans, Fetch&& fetch) {
+    auto start = Clock::now();
+    for (int i = 0; i < scans; i++) {
+        fetch();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / scans;
+}
+
+/**
+* Requests and wall time per scan of every pair the Token enum allows, one
+* bulk /market/tickers request against a depth request per pair, with a
+* local stand-in serving a spot list of a few hundred symbols.
+* usage: bench_batch_bbo [scans=20] [filler_symbols=500]
+*/
+int main(int argc, char** argv) {
+    int scans = argc > 1 ? std::atoi(argv[1]) : 20;
+    int filler = argc > 2 ? std::atoi(argv[2]) : 500;
+
+    const std::string tickers = tickersPayload(filler);
+    LocalServer server([&](std::string_view target) -> std::string {
+        return target.find("/market/tickers") != std::string_view::npos ? tickers : DEPTH_PAYLOAD;
+    });
+
+    std::vector<Instrument> instruments;
+    for (Token base : TOKENS) {
+        for (Token quote : TOKENS) {
+            if (base != quote) {
+                instruments.emplace_back(base, quote, Exchange::BYBIT, FeedType::SPOT);
+            }
+        }
+    }
+    std::span<const Instrument> two(instruments.data(), 2);
+
+    ByBitGateway bulk(server.url("/v5"));
+    FanOutByBitGateway fanOut(server.url("/v5"));
+    bulk.getBBOs(instruments);
+    fanOut.getBBOs(instruments);
+
+    size_t quoted = 0;
+    uint64_t served = server.served();
+    double bulkAll = scanMicros(scans, [&]() {
+        for (const BBO& bbo : bulk.getBBOs(instruments)) {
+            quoted += bbo.timestamp != 0;
+        }
+    });
+    uint64_t bulkRequests = server.served() - served;
+
+    double bulkTwo = scanMicros(scans, [&]() { bulk.getBBOs(two); });
+
+    served = server.served();
+    double fanOutAll = scanMicros(scans, [&]() { fanOut.getBBOs(instruments); });
+    uint64_t fanOutRequests = server.served() - served;
+
+    std::cout << "pairs per scan            : " << instruments.size() << "\n"
+              << "symbols in tickers answer : " << instruments.size() + filler << "\n"
+              << "quoted / asked            : " << quoted << " / " << instruments.size() * scans << "\n"
+              << "bulk requests / scan      : " << static_cast<double>(bulkRequests) / scans << "\n"
+              << "fan out requests / scan   : " << static_cast<double>(fanOutRequests) / scans << "\n"
+              << "bulk us / scan, 2 pairs   : " << bulkTwo << "\n"
+              << "bulk us / scan, all pairs : " << bulkAll << "\n"
+              << "fan out us / scan         : " << fanOutAll << "\n";
+
+    bulk.destroy();
+    fanOut.destroy();
+    return 0;
+}
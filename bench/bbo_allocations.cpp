@@ -0,0 +1,84 @@
+#include "local_server.hpp"
+#include "binance/BinanceGateway.cpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Every heap allocation in the process, including the event loop thread
+static std::atomic<uint64_t> g_allocations{0};
+static std::atomic<uint64_t> g_bytes{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+static const char* DEPTH_PAYLOAD =
+    R"({"lastUpdateId":58373620913,)"
+    R"("bids":[["96508.10000000","0.52010000"],["96508.00000000","0.00006000"],["96507.99000000","0.01245000"],)"
+    R"(["96507.50000000","0.31000000"],["96507.01000000","0.00010000"]],)"
+    R"("asks":[["96508.11000000","0.25730000"],["96508.12000000","0.00012000"],["96508.50000000","0.08010000"],)"
+    R"(["96509.00000000","0.43000000"],["96509.99000000","0.00500000"]]})";
+
+// Exposes the gateway's AsyncHttp to time the bare transport
+class RawBinanceGateway : public BinanceGateway {
+    public:
+        using BinanceGateway::BinanceGateway;
+        AsyncHttp& http() { return getHttp(); }
+};
+
+/**
+* Heap allocations per BinanceGateway::getBBO against a local stand-in,
+* and per bare get_raw round trip to isolate the http response path.
+* usage: bench_bbo_allocations [iterations=2000]
+*/
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    LocalServer server(DEPTH_PAYLOAD);
+    RawBinanceGateway gateway(server.url("/api/v3"));
+
+    // Warm up connections, buffers and pools
+    for (int i = 0; i < 100; i++) {
+        gateway.getBBO(Token::BTC, Token::USDC);
+    }
+
+    uint64_t allocations = g_allocations.load();
+    uint64_t bytes = g_bytes.load();
+    double checksum = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        checksum += gateway.getBBO(Token::BTC, Token::USDC).bid.price;
+    }
+
+    allocations = g_allocations.load() - allocations;
+    bytes = g_bytes.load() - bytes;
+
+    const std::string url = server.url("/api/v3/depth?symbol=BTCUSDC");
+    uint64_t raw_allocations = g_allocations.load();
+    size_t received = 0;
+
+    for (int i = 0; i < iterations; i++) {
+        received += gateway.http().get_raw(url).get().body.size();
+    }
+
+    raw_allocations = g_allocations.load() - raw_allocations;
+
+    std::cout << "iterations              : " << iterations << "\n"
+              << "allocations / getBBO    : " << static_cast<double>(allocations) / iterations << "\n"
+              << "bytes / getBBO          : " << static_cast<double>(bytes) / iterations << "\n"
+              << "allocations / get_raw   : " << static_cast<double>(raw_allocations) / iterations << "\n"
+              << "checksum                : " << checksum / iterations << " " << received / iterations << "\n";
+
+    gateway.destroy();
+    return 0;
+}
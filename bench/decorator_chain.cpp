@@ -0,0 +1,111 @@
+#include "decorator.hpp"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+// Threads currently alive in this process, as reported by the kernel
+static int threadCount() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) {
+            return std::atoi(line.c_str() + 8);
+        }
+    }
+    return -1;
+}
+
+// Answers from memory, so only the layers around it are timed
+class StubGateway : public Gateway {
+    public:
+        StubGateway() { name = Exchange::BINANCE; }
+        BBO getBBO(Token, Token) override {
+            return BBO{PriceLevel{965081000, 52010000}, PriceLevel{965081100, 25730000}, 1737043526442};
+        }
+        std::string getTicker(Token&, Token&) override { return "BTCUSDC"; }
+};
+
+// A layer that only forwards, to time dispatch on its own
+template<typename Inner>
+class PassThrough : public Inner {
+    public:
+        using Inner::Inner;
+        BBO getBBO(Token base, Token quote) override { return Inner::getBBO(base, quote); }
+};
+
+static double nanosPerBBO(Gateway* gateway, int iterations) {
+    int64_t sink = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += gateway->getBBO(Token::BTC, Token::USDC).bid.price;
+        asm volatile("" : : "g"(&sink) : "memory");
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+/**
+* getBBO through a Gateway* for the virtual decorator chain
+* LatencyDecorator(LoggingDecorator(gateway)) against the same layers as
+* mixins, Instrumented<Logged<gateway>>, over a gateway answering from
+* memory. Both log through one AsyncLogger writing to a temporary directory.
+* Two layers that only forward are timed as well, for the dispatch alone.
+* usage: bench_decorator_chain [iterations=30000] [rounds=5]
+*/
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 30000;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    // the shared logger writes to the working directory
+    char directory[] = "/tmp/cexa_logs_XXXXXX";
+    if (!mkdtemp(directory) || chdir(directory) != 0) {
+        std::cerr << "[ERROR] Cannot create a temporary directory" << std::endl;
+        return 1;
+    }
+    AsyncLogger::shared();
+
+    int threads = threadCount();
+    Gateway* chain = new LatencyDecorator(new LoggingDecorator(new StubGateway()));
+    int chainThreads = threadCount() - threads;
+
+    threads = threadCount();
+    Gateway* mixin = new Instrumented<Logged<StubGateway>>();
+    int mixinThreads = threadCount() - threads;
+
+    StubGateway bare;
+    Gateway* forwardingChain = new GatewayDecorator(new GatewayDecorator(new StubGateway()));
+    Gateway* forwardingMixin = new PassThrough<PassThrough<StubGateway>>();
+
+    // alternate, and keep each run below the logger's ring capacity
+    double bareNs = 0, chainNs = 0, mixinNs = 0, forwardingChainNs = 0, forwardingMixinNs = 0;
+    for (int round = 0; round < rounds; round++) {
+        bareNs += nanosPerBBO(&bare, iterations);
+        forwardingChainNs += nanosPerBBO(forwardingChain, iterations * 100);
+        forwardingMixinNs += nanosPerBBO(forwardingMixin, iterations * 100);
+        chainNs += nanosPerBBO(chain, iterations);
+        AsyncLogger::shared().flush();
+        mixinNs += nanosPerBBO(mixin, iterations);
+        AsyncLogger::shared().flush();
+    }
+
+    std::cout << "getBBO ns, bare gateway        : " << bareNs / rounds << "\n"
+              << "forwarding only, chain / mixin : " << forwardingChainNs / rounds << " / " << forwardingMixinNs / rounds << "\n"
+              << "getBBO ns, virtual chain       : " << chainNs / rounds << "\n"
+              << "getBBO ns, mixins              : " << mixinNs / rounds << "\n"
+              << "objects, virtual chain / mixin : 3 / 1\n"
+              << "threads, virtual chain / mixin : " << chainThreads << " / " << mixinThreads << "\n"
+              << "dropped log records            : " << AsyncLogger::shared().dropped() << "\n"
+              << "logs in                        : " << directory << "\n";
+
+    delete chain;
+    delete mixin;
+    delete forwardingChain;
+    delete forwardingMixin;
+    return 0;
+}
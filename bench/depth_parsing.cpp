@@ -0,0 +1,188 @@
+#include "binance/BinanceGateway.cpp"
+#include "bybit/ByBitGateway.cpp"
+#include "okx/OkxGateway.cpp"
+#include "base/BaseGateway.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+// Every heap allocation in the process
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+using Clock = std::chrono::steady_clock;
+
+// Same shape as a BTCUSDC /api/v3/depth answer at the default 100 levels
+static std::string binanceDepth() {
+    std::string body = R"({"lastUpdateId":58373620913,"bids":[)";
+    for (int i = 0; i < 100; i++) {
+        body += (i ? "," : "");
+        body += "[\"" + std::to_string(96508 - i) + ".10000000\",\"0.0" + std::to_string(1000 + i * 37) + "000\"]";
+    }
+    body += R"(],"asks":[)";
+    for (int i = 0; i < 100; i++) {
+        body += (i ? "," : "");
+        body += "[\"" + std::to_string(96509 + i) + ".20000000\",\"0.0" + std::to_string(2000 + i * 53) + "000\"]";
+    }
+    return body + "]}";
+}
+
+static const char* BYBIT_DEPTH =
+    R"({"retCode":0,"retMsg":"OK","result":{"s":"BTCUSDC","a":[["96508.2","0.080542"]],)"
+    R"("b":[["96508.1","0.370386"]],"ts":1737043526442,"u":2876924,"seq":47135468392,"cts":1737043526438},)"
+    R"("retExtInfo":{},"time":1737043526579})";
+
+static const char* OKX_DEPTH =
+    R"({"code":"0","msg":"","data":[{"asks":[["96508.2","0.59862919","0","7"]],)"
+    R"("bids":[["96508.1","0.15620536","0","3"]],"ts":"1737043526479"}]})";
+
+static const char* COINBASE_DEPTH =
+    R"({"bids":[["96508.1","0.04263151",3]],"asks":[["96508.2","0.34612704",5]],)"
+    R"("sequence":96811416331,"auction_mode":false,"auction":null,"time":"2025-01-16T16:05:26.418931Z"})";
+
+static const char* BINANCE_TICKER =
+    R"({"u":54907563297,"s":"BTCUSDC","b":"96508.10000000","B":"0.52010000","a":"96508.11000000","A":"0.25730000"})";
+
+static const char* COINBASE_TICKER =
+    R"({"type":"ticker","sequence":96811416332,"product_id":"BTC-USDC","price":"96508.15","open_24h":"95711.99",)"
+    R"("volume_24h":"9563.05421361","low_24h":"94309.47","high_24h":"97371","volume_30d":"339025.16962862",)"
+    R"("best_bid":"96508.10","best_bid_size":"0.04263151","best_ask":"96508.20","best_ask_size":"0.34612704",)"
+    R"("side":"buy","time":"2025-01-16T16:05:26.418931Z","trade_id":775914622,"last_size":"0.00012"})";
+
+// The DOM based extraction the gateways used before, top of both sides as doubles
+static double domTop(const std::string& body, const char* bids, const char* asks, const char* outer = nullptr) {
+    json data = json::parse(body);
+    const json& book = outer ? data[outer] : data;
+    const json& side = book.is_array() ? book[0] : book;
+    return std::stod(side[bids][0][0].get<std::string>()) + std::stod(side[bids][0][1].get<std::string>()) +
+        std::stod(side[asks][0][0].get<std::string>()) + std::stod(side[asks][0][1].get<std::string>());
+}
+
+// What MarketStream does with a frame: locate the fields, then scale them
+template<typename Protocol>
+static int64_t streamTop(Protocol& protocol, std::string_view frame, PairScale scale, BBO& bbo) {
+    std::string_view ticker;
+    WireQuote wire{};
+    protocol.parse(frame, ticker, wire);
+    scale.parseLevel(wire.bidPrice, wire.bidSize, bbo.bid);
+    scale.parseLevel(wire.askPrice, wire.askSize, bbo.ask);
+    return bbo.bid.price;
+}
+
+struct Result {
+    double ns;
+    double allocations;
+};
+
+template<typename Parse>
+Result run(int iterations, Parse&& parse) {
+    double sink = 0;
+    uint64_t allocations = g_allocations.load();
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += parse();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    if (sink == 42) {
+        std::cout << "";
+    }
+    return Result{elapsed / iterations, static_cast<double>(g_allocations.load() - allocations) / iterations};
+}
+
+static void report(const char* payload, Result before, Result after) {
+    std::cout << std::left << std::setw(26) << payload
+              << std::right << std::setw(12) << before.ns << std::setw(12) << after.ns
+              << std::setw(10) << before.allocations << std::setw(10) << after.allocations << "\n";
+}
+
+/**
+* Parse time and heap allocations per payload, nlohmann DOM plus std::stod
+* against the gateways' DepthParser based extractors converting straight to
+* fixed point, for every venue's REST depth answer and the ticker frames the
+* streams read.
+* usage: bench_depth_parsing [iterations=200000]
+*/
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    const std::string binance = binanceDepth();
+    const std::string bybit = BYBIT_DEPTH;
+    const std::string okx = OKX_DEPTH;
+    const std::string coinbase = COINBASE_DEPTH;
+    const std::string binanceTicker = BINANCE_TICKER;
+    const std::string coinbaseTicker = COINBASE_TICKER;
+
+    const PairScale scale = scaleOf(Token::BTC, Token::USDC);
+    BinanceDepths depths{};
+    BBO bbo{};
+    BinanceStreamProtocol binanceStream;
+    CoinbaseStreamProtocol coinbaseStream;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << std::left << std::setw(26) << "payload"
+              << std::right << std::setw(12) << "dom ns" << std::setw(12) << "fast ns"
+              << std::setw(10) << "dom allc" << std::setw(10) << "fast allc" << "\n";
+
+    // Binance keeps every level, so the DOM side converts them all as well
+    report("binance depth (100 lvl)",
+        run(iterations / 10, [&]() {
+            json data = json::parse(binance);
+            double total = 0;
+            for (const char* side : {"bids", "asks"}) {
+                for (const auto& level : data[side]) {
+                    total += std::stod(level[0].get<std::string>()) + std::stod(level[1].get<std::string>());
+                }
+            }
+            return total;
+        }),
+        run(iterations / 10, [&]() {
+            BinanceGateway::parseDepths(binance, scale, depths);
+            return depths.bids[0].price;
+        }));
+
+    report("bybit depth",
+        run(iterations, [&]() { return domTop(bybit, "b", "a", "result"); }),
+        run(iterations, [&]() { ByBitGateway::parseDepth(bybit, scale, bbo); return bbo.bid.price; }));
+
+    report("okx depth",
+        run(iterations, [&]() { return domTop(okx, "bids", "asks", "data"); }),
+        run(iterations, [&]() { OkxGateway::parseDepth(okx, scale, bbo); return bbo.bid.price; }));
+
+    report("coinbase depth",
+        run(iterations, [&]() { return domTop(coinbase, "bids", "asks"); }),
+        run(iterations, [&]() { CoinbaseGateway::parseDepth(coinbase, scale, bbo); return bbo.bid.price; }));
+
+    report("binance bookTicker",
+        run(iterations, [&]() {
+            json data = json::parse(binanceTicker);
+            return std::stod(data["b"].get<std::string>()) + std::stod(data["B"].get<std::string>()) +
+                std::stod(data["a"].get<std::string>()) + std::stod(data["A"].get<std::string>());
+        }),
+        run(iterations, [&]() { return streamTop(binanceStream, binanceTicker, scale, bbo); }));
+
+    report("coinbase ticker",
+        run(iterations, [&]() {
+            json data = json::parse(coinbaseTicker);
+            return std::stod(data["best_bid"].get<std::string>()) + std::stod(data["best_bid_size"].get<std::string>()) +
+                std::stod(data["best_ask"].get<std::string>()) + std::stod(data["best_ask_size"].get<std::string>());
+        }),
+        run(iterations, [&]() { return streamTop(coinbaseStream, coinbaseTicker, scale, bbo); }));
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "local_server.hpp"
+#include "common/AsyncHttp.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Threads currently alive in this process, as reported by the kernel
+static int thread_count() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) {
+            return std::stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+/**
+* Sustained typed get<json> load against a local stand-in exchange.
+* usage: bench_http_threads [seconds=5] [requests_per_second=1000] [server_delay_ms=0]
+* A large server delay simulates a stalled venue: requests pile up in the queue,
+* the process thread count must stay flat.
+*/
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+    int rate = argc > 2 ? std::atoi(argv[2]) : 1000;
+    int delay_ms = argc > 3 ? std::atoi(argv[3]) : 0;
+
+    LocalServer server(
+        R"({"lastUpdateId":1,"bids":[["96508.10","0.5"]],"asks":[["96508.20","0.25"]]})",
+        std::chrono::milliseconds(delay_ms));
+
+    int baseline_threads = thread_count();
+
+    AsyncHttp http;
+    http.init(5);
+
+    std::vector<std::future<nlohmann::json>> futures;
+    futures.reserve(static_cast<size_t>(seconds) * rate);
+
+    int max_threads = thread_count();
+    auto interval = std::chrono::microseconds(1000000 / std::max(rate, 1));
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    auto next_sample = start;
+
+    while (std::chrono::steady_clock::now() - start < std::chrono::seconds(seconds)) {
+        futures.push_back(http.get<nlohmann::json>(server.url("/api/v3/depth?symbol=BTCUSDC")));
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_sample) {
+            max_threads = std::max(max_threads, thread_count());
+            next_sample = now + std::chrono::milliseconds(100);
+        }
+
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+
+    size_t ok = 0;
+    size_t failed = 0;
+    for (auto& future : futures) {
+        try {
+            future.get();
+            ok++;
+        } catch (const std::exception&) {
+            failed++;
+        }
+        max_threads = std::max(max_threads, thread_count());
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "requests issued : " << futures.size() << "\n"
+              << "completed ok    : " << ok << "\n"
+              << "failed          : " << failed << "\n"
+              << "elapsed         : " << elapsed << " s\n"
+              << "throughput      : " << static_cast<size_t>(ok / elapsed) << " req/s\n"
+              << "threads before  : " << baseline_threads << " (main + stand-in server)\n"
+              << "threads max     : " << max_threads << "\n";
+
+    http.destroy();
+    return 0;
+}
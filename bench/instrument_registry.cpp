@@ -0,0 +1,87 @@
+#include "okx/OkxGateway.cpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+static const Token tokens[] = {Token::BTC, Token::ETH, Token::USDC, Token::USDT};
+
+// ns per call of f(i) over iterations calls
+template<typename F>
+static double nsPerCall(int iterations, F&& f) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f(i);
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+/**
+* What resolving an instrument costs: the venue's ticker built through a
+* stringstream as getTicker used to, by concatenation as it does now, and
+* read from the registry; an instrument found by hashing its name against
+* its dense id; and parsing one from its name.
+* usage: bench_instrument_registry [iterations=1000000]
+*/
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    OkxGateway okx;
+    InstrumentRegistry& registry = InstrumentRegistry::shared();
+    std::unordered_map<std::string, InstrumentId> byName;
+    for (Token base : tokens) {
+        for (Token quote : tokens) {
+            InstrumentId id = okx.instrumentId(base, quote);
+            byName.emplace(registry.name(id), id);
+        }
+    }
+    auto pair = [](int i) { return std::make_pair(tokens[i & 3], tokens[(i >> 2) & 3]); };
+
+    size_t sink = 0;
+    double stream = nsPerCall(iterations, [&](int i) {
+        auto [base, quote] = pair(i);
+        std::stringstream ss;
+        ss << base << "-" << quote;
+        sink += ss.str().size();
+    });
+    double concat = nsPerCall(iterations, [&](int i) {
+        auto [base, quote] = pair(i);
+        sink += okx.getTicker(base, quote).size();
+    });
+    double interned = nsPerCall(iterations, [&](int i) {
+        auto [base, quote] = pair(i);
+        sink += okx.symbol(base, quote).size();
+    });
+
+    const std::string name = "OKX:ETH/USDT:SPOT";
+    double hashed = nsPerCall(iterations, [&](int) {
+        sink += byName.find(Instrument(Token::ETH, Token::USDT, Exchange::OKX, FeedType::SPOT).toString())->second;
+    });
+    double dense = nsPerCall(iterations, [&](int i) {
+        auto [base, quote] = pair(i);
+        sink += registry.find(Exchange::OKX, base, quote);
+    });
+    double byString = nsPerCall(iterations, [&](int) {
+        sink += registry.find(name);
+    });
+    double parsed = nsPerCall(iterations, [&](int) {
+        sink += static_cast<size_t>(Instrument::fromString(name).quoteSymbol);
+    });
+
+    std::cout << "instruments interned           : " << registry.size() << "\n"
+              << "ticker ns, stringstream        : " << stream << "\n"
+              << "ticker ns, concatenation       : " << concat << "\n"
+              << "ticker ns, registry            : " << interned << "\n"
+              << "lookup ns, name hash           : " << hashed << "\n"
+              << "lookup ns, registry by key     : " << dense << "\n"
+              << "lookup ns, registry by name    : " << byString << "\n"
+              << "Instrument::fromString ns      : " << parsed << " (" << sink % 2 << ")\n";
+
+    okx.destroy();
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "binance/BinanceGateway.cpp"
+#include "common/InstrumentUniverse.hpp"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+template<typename F>
+static double millis(F&& f) {
+    auto start = Clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename F>
+static double nsPerCall(int iterations, F&& f) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f(i);
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+// An /exchangeInfo answer listing every asset against USDT and USDC
+static std::string exchangeInfo(int assets) {
+    std::string body = R"({"timezone":"UTC","symbols":[)";
+    for (int a = 0; a < assets; a++) {
+        for (const char* quote : {"USDT", "USDC"}) {
+            std::string base = "A" + std::to_string(a);
+            body += (body.back() == '[' ? "" : ",");
+            body += R"({"symbol":")" + base + quote + R"(","status":")" + (a % 10 ? "TRADING" : "BREAK") +
+                R"(","baseAsset":")" + base + R"(","quoteAsset":")" + quote + R"(","isSpotTradingAllowed":true,)"
+                R"("filters":[{"filterType":"PRICE_FILTER","tickSize":"0.00010000"},)"
+                R"({"filterType":"LOT_SIZE","stepSize":"0.01000000"}]})";
+        }
+    }
+    return body + "]}";
+}
+
+/**
+* Loads a universe of synthetic listings the size of the big venues' spot
+* markets: parse of a Binance /exchangeInfo, the intersection across venues,
+* registering the scannable pairs and a cache round trip. Then what the scan
+* loop pays per pair with thousands registered, against the built in pairs.
+* usage: bench_instrument_universe [assets=1500] [iterations=1000000]
+*/
+int main(int argc, char** argv) {
+    int assets = argc > 1 ? std::atoi(argv[1]) : 1500;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+    const std::string body = exchangeInfo(assets);
+    std::vector<Listing> binance;
+    double parseMs = millis([&]() { binance = BinanceGateway::parseListings(body); });
+
+    // the other venues list the same assets under their own tickers, each a
+    // little fewer of them
+    InstrumentUniverse universe;
+    const Exchange others[] = {Exchange::BYBIT, Exchange::OKX, Exchange::COINBASE};
+    for (size_t v = 0; v < 3; v++) {
+        std::vector<Listing> listings;
+        for (const Listing& listing : binance) {
+            if (static_cast<size_t>(listing.base) % 4 != v) {
+                Listing copy = listing;
+                copy.exchange = others[v];
+                copy.ticker = EnumTraits<Token>::toString(listing.base) + "-" + EnumTraits<Token>::toString(listing.quote);
+                copy.tickSize = "0.00001";
+                listings.push_back(std::move(copy));
+            }
+        }
+        universe.add(std::move(listings));
+    }
+    universe.add(std::move(binance));
+
+    const std::vector<Exchange> venues = {Exchange::BINANCE, Exchange::BYBIT, Exchange::OKX, Exchange::COINBASE};
+    std::vector<Instrument> pairs;
+    double scannableMs = millis([&]() { pairs = universe.scannable(venues); });
+    double applyMs = millis([&]() { universe.apply(pairs); });
+
+    char path[] = "/tmp/cexa_universe_XXXXXX.json";
+    int fd = mkstemps(path, 5);
+    close(fd);
+    double saveMs = millis([&]() { universe.save(path); });
+    InstrumentUniverse cached;
+    double loadMs = millis([&]() { cached.load(path); });
+    std::remove(path);
+
+    InstrumentRegistry& registry = InstrumentRegistry::shared();
+    size_t sink = 0;
+    auto pair = [&](int i) -> const Instrument& { return pairs[static_cast<size_t>(i) % pairs.size()]; };
+    double loadedScale = nsPerCall(iterations, [&](int i) {
+        sink += scaleOf(pair(i).baseSymbol, pair(i).quoteSymbol).priceDecimals;
+    });
+    double builtinScale = nsPerCall(iterations, [&](int i) {
+        sink += defaultScaleOf(pair(i).baseSymbol, pair(i).quoteSymbol).priceDecimals;
+    });
+    double lookup = nsPerCall(iterations, [&](int i) {
+        sink += registry.find(Exchange::OKX, pair(i).baseSymbol, pair(i).quoteSymbol);
+    });
+
+    std::cout << "tokens / listings / scannable   : " << TokenTable::shared().size() << " / "
+              << universe.size() << " / " << pairs.size() << "\n"
+              << "ms, parse exchangeInfo (" << body.size() / 1024 << "KB)  : " << parseMs << "\n"
+              << "ms, intersect venues            : " << scannableMs << "\n"
+              << "ms, register tickers and scales : " << applyMs << "\n"
+              << "ms, cache save / load           : " << saveMs << " / " << loadMs << "\n"
+              << "ns, scaleOf loaded / built in   : " << loadedScale << " / " << builtinScale << "\n"
+              << "ns, instrument id of a pair     : " << lookup << " (" << sink % 2 << ")\n";
+    return 0;
+}
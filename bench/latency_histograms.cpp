@@ -0,0 +1,101 @@
+#include "local_server.hpp"
+#include "binance/BinanceGateway.cpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const char* DEPTH_PAYLOAD =
+    R"({"lastUpdateId":58373620913,)"
+    R"("bids":[["96508.10000000","0.52010000"],["96508.00000000","0.00006000"],["96507.99000000","0.01245000"]],)"
+    R"("asks":[["96508.11000000","0.25730000"],["96508.12000000","0.00012000"],["96508.50000000","0.08010000"]]})";
+
+static const char* TICKERS_PAYLOAD =
+    R"([{"symbol":"BTCUSDC","bidPrice":"96508.10000000","bidQty":"0.52010000","askPrice":"96508.11000000","askQty":"0.25730000"},)"
+    R"({"symbol":"ETHUSDC","bidPrice":"3301.10000000","bidQty":"4.10000000","askPrice":"3301.11000000","askQty":"2.50000000"}])";
+
+// Nanoseconds per record() with threads recording at once
+template<typename Record>
+static double nanosPerRecord(int threads, int iterations, Record&& record) {
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < iterations; i++) {
+                record(static_cast<uint64_t>(i * 7919 + t) % 5000000);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+/**
+* Per endpoint and phase latency of BinanceGateway's depth and bulk ticker
+* requests against a local stand-in, as dumpLatency prints it, in two
+* intervals; the second runs into the venue's request weight limit, which
+* shows up as queue wait. Then the cost of a record() on the hot path, lock
+* free against a mutex guarded sample vector, from one and several threads.
+* usage: bench_latency_histograms [requests=500] [threads=4]
+*/
+int main(int argc, char** argv) {
+    int requests = argc > 1 ? std::atoi(argv[1]) : 500;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 4;
+
+    LocalServer server([](std::string_view target) -> std::string {
+        return target.find("/ticker/bookTicker") != std::string_view::npos ? TICKERS_PAYLOAD : DEPTH_PAYLOAD;
+    }, std::chrono::milliseconds(1));
+
+    BinanceGateway gateway(server.url("/api/v3"));
+    std::vector<Instrument> instruments = {
+        Instrument(Token::BTC, Token::USDC, Exchange::BINANCE, FeedType::SPOT),
+        Instrument(Token::ETH, Token::USDC, Exchange::BINANCE, FeedType::SPOT)
+    };
+
+    LatencyRecorder::writeHeader(std::cout);
+    for (int interval = 0; interval < 2; interval++) {
+        for (int i = 0; i < requests; i++) {
+            gateway.getBBO(Token::BTC, Token::USDC);
+            gateway.getBBOs(instruments);
+        }
+        gateway.latency().dump(std::cout, "BINANCE");
+        std::cout << "\n";
+    }
+
+    int iterations = 2000000;
+    LatencyHistogram histogram;
+    std::mutex samplesMutex;
+    std::vector<uint64_t> samples;
+    samples.reserve(static_cast<size_t>(iterations) * std::max(threads, 1));
+
+    double lockFree = nanosPerRecord(1, iterations, [&](uint64_t nanos) { histogram.record(nanos); });
+    double locked = nanosPerRecord(1, iterations, [&](uint64_t nanos) {
+        std::lock_guard<std::mutex> lock(samplesMutex);
+        samples.push_back(nanos);
+    });
+    double lockFreeContended = nanosPerRecord(threads, iterations, [&](uint64_t nanos) { histogram.record(nanos); });
+    samples.clear();
+    double lockedContended = nanosPerRecord(threads, iterations, [&](uint64_t nanos) {
+        std::lock_guard<std::mutex> lock(samplesMutex);
+        samples.push_back(nanos);
+    });
+
+    auto start = Clock::now();
+    auto snapshot = histogram.snapshot();
+    double snapshotUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    std::cout << "record ns, histogram / mutex            : " << lockFree << " / " << locked << "\n"
+              << "record ns, " << threads << " threads, histogram / mutex : " << lockFreeContended << " / " << lockedContended << "\n"
+              << "snapshot us                             : " << snapshotUs << "\n"
+              << "recorded, p99.9 ns                      : " << snapshot.count() << ", " << snapshot.percentile(99.9) << "\n";
+
+    gateway.destroy();
+    return 0;
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+* @brief Single threaded HTTP/1.1 keep-alive server standing in for an exchange.
+* Replays a canned body for every request, optionally after a fixed delay to
+* simulate a stalled venue. Used only by the benchmarks.
+*/
+class LocalServer {
+    public:
+        // Maps the request target (path + query) to the response body
+        using Handler = std::function<std::string(std::string_view target)>;
+
+        LocalServer(Handler handler,
+                    std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+                    std::string extra_headers = "")
+            : handler_(std::move(handler)), delay_(delay),
+              extra_headers_(std::move(extra_headers)), running_(true) {
+            listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(listen_fd_, 128) != 0) {
+                throw std::runtime_error("LocalServer: cannot listen on loopback");
+            }
+
+            socklen_t len = sizeof(addr);
+            ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+            port_ = ntohs(addr.sin_port);
+
+            thread_ = std::thread(&LocalServer::loop, this);
+        }
+
+        explicit LocalServer(std::string body,
+                             std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+                             std::string extra_headers = "")
+            : LocalServer([body = std::move(body)](std::string_view) { return body; },
+                          delay, std::move(extra_headers)) {}
+
+        ~LocalServer() {
+            running_ = false;
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+            for (auto& conn : conns_) {
+                ::close(conn.fd);
+            }
+            ::close(listen_fd_);
+        }
+
+        std::string url(const std::string& path = "") const {
+            return "http://127.0.0.1:" + std::to_string(port_) + path;
+        }
+
+        uint64_t served() const { return served_.load(); }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Pending {
+            Clock::time_point due;
+            std::string response;
+        };
+
+        struct Conn {
+            int fd;
+            std::string in;
+            std::string out;
+            std::deque<Pending> pending;
+        };
+
+        Handler handler_;
+        std::chrono::milliseconds delay_;
+        std::string extra_headers_;
+        std::atomic<bool> running_;
+        std::atomic<uint64_t> served_{0};
+        int listen_fd_;
+        uint16_t port_;
+        std::vector<Conn> conns_;
+        std::thread thread_;
+
+        void loop() {
+            std::vector<pollfd> fds;
+
+            while (running_) {
+                auto now = Clock::now();
+                int timeout_ms = 50;
+
+                for (auto& conn : conns_) {
+                    while (!conn.pending.empty() && conn.pending.front().due <= now) {
+                        conn.out += conn.pending.front().response;
+                        conn.pending.pop_front();
+                    }
+                    if (!conn.pending.empty()) {
+                        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            conn.pending.front().due - now).count();
+                        timeout_ms = std::min<int>(timeout_ms, static_cast<int>(wait) + 1);
+                    }
+                }
+
+                fds.clear();
+                fds.push_back({listen_fd_, POLLIN, 0});
+                for (auto& conn : conns_) {
+                    fds.push_back({conn.fd, static_cast<short>(POLLIN | (conn.out.empty() ? 0 : POLLOUT)), 0});
+                }
+
+                if (::poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+                    continue;
+                }
+
+                if (fds[0].revents & POLLIN) {
+                    int fd = ::accept(listen_fd_, nullptr, nullptr);
+                    if (fd >= 0) {
+                        int one = 1;
+                        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                        conns_.push_back(Conn{fd, {}, {}, {}});
+                    }
+                }
+
+                for (size_t i = 1; i < fds.size(); i++) {
+                    Conn& conn = conns_[i - 1];
+                    if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                        char buf[16384];
+                        ssize_t n = ::recv(conn.fd, buf, sizeof(buf), 0);
+                        if (n <= 0) {
+                            ::close(conn.fd);
+                            conn.fd = -1;
+                            continue;
+                        }
+                        conn.in.append(buf, static_cast<size_t>(n));
+                        parse_requests(conn);
+                    }
+                    if ((fds[i].revents & POLLOUT) && !conn.out.empty()) {
+                        ssize_t n = ::send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+                        if (n > 0) {
+                            conn.out.erase(0, static_cast<size_t>(n));
+                        }
+                    }
+                }
+
+                std::erase_if(conns_, [](const Conn& conn) { return conn.fd < 0; });
+            }
+        }
+
+        void parse_requests(Conn& conn) {
+            while (true) {
+                size_t header_end = conn.in.find("\r\n\r\n");
+                if (header_end == std::string::npos) {
+                    return;
+                }
+
+                std::string_view head(conn.in.data(), header_end);
+                size_t content_length = 0;
+                size_t cl = head.find("Content-Length:");
+                if (cl == std::string_view::npos) {
+                    cl = head.find("content-length:");
+                }
+                if (cl != std::string_view::npos) {
+                    content_length = std::stoul(std::string(head.substr(cl + 15, 20)));
+                }
+
+                size_t total = header_end + 4 + content_length;
+                if (conn.in.size() < total) {
+                    return;
+                }
+
+                size_t target_start = head.find(' ') + 1;
+                size_t target_end = head.find(' ', target_start);
+                bool is_head = head.substr(0, 4) == "HEAD";
+                std::string body = handler_(head.substr(target_start, target_end - target_start));
+
+                std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                       "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                                       extra_headers_ + "\r\n";
+                if (!is_head) {
+                    response += body;
+                }
+
+                conn.pending.push_back({Clock::now() + delay_, std::move(response)});
+                conn.in.erase(0, total);
+                served_++;
+            }
+        }
+};
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "common/WebSocket.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+* @brief Single threaded WebSocket server standing in for a venue feed.
+* Once a connection sends any text frame (its subscription) it receives the
+* canned frames in order, one every interval, looping forever. Used only by
+* the benchmarks.
+*/
+class LocalWebSocketServer {
+    public:
+        LocalWebSocketServer(std::vector<std::string> frames,
+                             std::chrono::microseconds interval = std::chrono::microseconds(1000))
+            : frames_(std::move(frames)), interval_(interval), running_(true) {
+            listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = 0;
+            if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(listen_fd_, 16) != 0) {
+                throw std::runtime_error("LocalWebSocketServer: cannot listen on loopback");
+            }
+
+            socklen_t len = sizeof(addr);
+            ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+            port_ = ntohs(addr.sin_port);
+
+            thread_ = std::thread(&LocalWebSocketServer::loop, this);
+        }
+
+        ~LocalWebSocketServer() {
+            running_ = false;
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+            for (auto& conn : conns_) {
+                ::close(conn.fd);
+            }
+            ::close(listen_fd_);
+        }
+
+        std::string url(const std::string& path = "/ws") const {
+            return "ws://127.0.0.1:" + std::to_string(port_) + path;
+        }
+
+        // Closes every connection without a close frame, like a venue restart
+        void drop_all() { drop_.store(true); }
+
+        uint64_t connections() const { return connections_.load(); }
+        uint64_t subscriptions() const { return subscriptions_.load(); }
+        uint64_t sent() const { return sent_.load(); }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Conn {
+            int fd;
+            bool upgraded = false;
+            bool subscribed = false;
+            std::string in;
+            std::string out;
+            size_t next = 0;
+        };
+
+        std::vector<std::string> frames_;
+        std::chrono::microseconds interval_;
+        std::atomic<bool> running_;
+        std::atomic<bool> drop_{false};
+        std::atomic<uint64_t> connections_{0};
+        std::atomic<uint64_t> subscriptions_{0};
+        std::atomic<uint64_t> sent_{0};
+        int listen_fd_;
+        uint16_t port_;
+        std::vector<Conn> conns_;
+        std::thread thread_;
+
+        static std::string frame(uint8_t opcode, std::string_view payload) {
+            std::string out;
+            out.push_back(static_cast<char>(0x80 | opcode));
+            if (payload.size() < 126) {
+                out.push_back(static_cast<char>(payload.size()));
+            } else if (payload.size() <= 0xFFFF) {
+                out.push_back(static_cast<char>(126));
+                out.push_back(static_cast<char>(payload.size() >> 8));
+                out.push_back(static_cast<char>(payload.size() & 0xFF));
+            } else {
+                out.push_back(static_cast<char>(127));
+                for (int i = 7; i >= 0; i--) {
+                    out.push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> (i * 8)) & 0xFF));
+                }
+            }
+            out.append(payload);
+            return out;
+        }
+
+        void loop() {
+            std::vector<pollfd> fds;
+            auto next_tick = Clock::now();
+
+            while (running_) {
+                if (drop_.exchange(false)) {
+                    for (auto& conn : conns_) {
+                        ::close(conn.fd);
+                    }
+                    conns_.clear();
+                }
+
+                auto now = Clock::now();
+                if (now >= next_tick) {
+                    for (auto& conn : conns_) {
+                        // a slow reader just misses ticks
+                        if (conn.subscribed && !frames_.empty() && conn.out.size() < (1 << 20)) {
+                            conn.out += frame(0x1, frames_[conn.next++ % frames_.size()]);
+                            sent_++;
+                        }
+                    }
+                    next_tick = now + interval_;
+                }
+
+                fds.clear();
+                fds.push_back({listen_fd_, POLLIN, 0});
+                for (auto& conn : conns_) {
+                    fds.push_back({conn.fd, static_cast<short>(POLLIN | (conn.out.empty() ? 0 : POLLOUT)), 0});
+                }
+
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_tick - Clock::now()).count();
+                if (::poll(fds.data(), fds.size(), static_cast<int>(std::clamp<long long>(wait, 0, 50))) <= 0) {
+                    continue;
+                }
+
+                if (fds[0].revents & POLLIN) {
+                    int fd = ::accept(listen_fd_, nullptr, nullptr);
+                    if (fd >= 0) {
+                        int one = 1;
+                        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                        conns_.push_back(Conn{fd, false, false, {}, {}, 0});
+                        connections_++;
+                    }
+                }
+
+                for (size_t i = 1; i < fds.size(); i++) {
+                    Conn& conn = conns_[i - 1];
+                    if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                        char buf[16384];
+                        ssize_t n = ::recv(conn.fd, buf, sizeof(buf), 0);
+                        if (n <= 0) {
+                            ::close(conn.fd);
+                            conn.fd = -1;
+                            continue;
+                        }
+                        conn.in.append(buf, static_cast<size_t>(n));
+                        if (!(conn.upgraded ? read_frames(conn) : handshake(conn))) {
+                            ::close(conn.fd);
+                            conn.fd = -1;
+                            continue;
+                        }
+                    }
+                    if ((fds[i].revents & POLLOUT) && !conn.out.empty()) {
+                        ssize_t n = ::send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+                        if (n > 0) {
+                            conn.out.erase(0, static_cast<size_t>(n));
+                        }
+                    }
+                }
+
+                std::erase_if(conns_, [](const Conn& conn) { return conn.fd < 0; });
+            }
+        }
+
+        bool handshake(Conn& conn) {
+            size_t end = conn.in.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                return true;
+            }
+
+            std::string_view head(conn.in.data(), end);
+            size_t at = head.find("Sec-WebSocket-Key:");
+            if (at == std::string_view::npos) {
+                return false;
+            }
+            std::string_view key = head.substr(at + 18);
+            key = key.substr(key.find_first_not_of(' '));
+            key = key.substr(0, key.find("\r\n"));
+
+            conn.out += "HTTP/1.1 101 Switching Protocols\r\n"
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Accept: " + WebSocketClient::accept_key(key) + "\r\n\r\n";
+            conn.upgraded = true;
+            conn.in.erase(0, end + 4);
+            return read_frames(conn);
+        }
+
+        // Client frames are masked, text marks the connection subscribed
+        bool read_frames(Conn& conn) {
+            while (conn.in.size() >= 2) {
+                auto* p = reinterpret_cast<uint8_t*>(conn.in.data());
+                uint8_t opcode = p[0] & 0x0F;
+                uint64_t length = p[1] & 0x7F;
+                size_t header = 2;
+                if (length == 126) {
+                    if (conn.in.size() < 4) return true;
+                    length = (uint64_t(p[2]) << 8) | p[3];
+                    header = 4;
+                } else if (length == 127) {
+                    return false;
+                }
+                if (conn.in.size() < header + 4 + length) {
+                    return true;
+                }
+
+                std::string payload = conn.in.substr(header + 4, length);
+                for (size_t i = 0; i < payload.size(); i++) {
+                    payload[i] ^= static_cast<char>(p[header + (i & 3)]);
+                }
+                conn.in.erase(0, header + 4 + length);
+
+                if (opcode == 0x8) {
+                    return false;
+                }
+                if (opcode == 0x9) {
+                    conn.out += frame(0xA, payload);
+                } else if (opcode == 0x1) {
+                    conn.subscribed = true;
+                    subscriptions_++;
+                }
+            }
+            return true;
+        }
+};
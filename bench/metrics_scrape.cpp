@@ -0,0 +1,91 @@
+#include "local_server.hpp"
+#include "binance/BinanceGateway.cpp"
+#include "arber/arber.bot.cpp"
+#include "utils/MetricsServer.hpp"
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static std::string depthPayload(int bid) {
+    return R"({"lastUpdateId":1,"bids":[[")" + std::to_string(bid) + R"(.0","1.0"]],)"
+        R"("asks":[[")" + std::to_string(bid) + R"(.5","1.0"]]})";
+}
+
+static size_t collect(char* data, size_t size, size_t count, void* body) {
+    static_cast<std::string*>(body)->append(data, size * count);
+    return size * count;
+}
+
+static double scanMicros(ArbitrageBot& bot, int scans) {
+    auto start = Clock::now();
+    for (int i = 0; i < scans; i++) {
+        bot.scan(Token::BTC, Token::USDC);
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / scans;
+}
+
+/**
+* Scan time over three local venues with nobody scraping against a client
+* scraping /metrics back to back, plus the time and size of one scrape.
+* usage: bench_metrics_scrape [scans=300]
+*/
+int main(int argc, char** argv) {
+    int scans = argc > 1 ? std::atoi(argv[1]) : 300;
+
+    std::vector<std::unique_ptr<LocalServer>> servers;
+    std::vector<std::unique_ptr<BinanceGateway>> venues;
+    ArbitrageBot bot(0.005, 1);
+    for (int i = 0; i < 3; i++) {
+        servers.push_back(std::make_unique<LocalServer>(depthPayload(100 + i)));
+        venues.push_back(std::make_unique<BinanceGateway>(servers.back()->url("/api/v3")));
+        bot.addExchange(venues.back().get());
+    }
+    MetricsServer server(0, [&bot](std::ostream& out) { bot.writeMetrics(out); });
+    const std::string url = "http://127.0.0.1:" + std::to_string(server.port()) + "/metrics";
+
+    scanMicros(bot, 20);
+    double quiet = scanMicros(bot, scans);
+
+    std::atomic<bool> scraping{true};
+    std::string body;
+    double scrapeMicros = 0;
+    std::thread scraper([&]() {
+        CURL* curl = curl_easy_init();
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, collect);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+        int scrapes = 0;
+        auto start = Clock::now();
+        while (scraping) {
+            body.clear();
+            curl_easy_perform(curl);
+            scrapes++;
+        }
+        scrapeMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / std::max(scrapes, 1);
+        curl_easy_cleanup(curl);
+    });
+    double scraped = scanMicros(bot, scans);
+    scraping = false;
+    scraper.join();
+
+    std::cout << "scan us, quiet / scraped   : " << quiet << " / " << scraped << "\n"
+              << "scrapes served             : " << server.scrapes() << "\n"
+              << "scrape us                  : " << scrapeMicros << "\n"
+              << "scrape bytes               : " << body.size() << "\n";
+
+    server.stop();
+    for (auto& venue : venues) {
+        venue->destroy();
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "local_server.hpp"
+#include "binance/BinanceGateway.cpp"
+#include "bybit/ByBitGateway.cpp"
+#include "arber/arber.bot.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t wallMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Median in us of to - from over the traces that have both stamps
+template<typename From, typename To>
+static double medianMicros(const std::vector<OpportunityTrace>& traces, From&& from, To&& to) {
+    std::vector<double> spans;
+    for (const auto& trace : traces) {
+        uint64_t start = from(trace), end = to(trace);
+        if (start && end && end >= start) {
+            spans.push_back((end - start) / 1000.0);
+        }
+    }
+    if (spans.empty()) {
+        return 0;
+    }
+    std::nth_element(spans.begin(), spans.begin() + spans.size() / 2, spans.end());
+    return spans[spans.size() / 2];
+}
+
+/**
+* Runs the bot for a while against a Binance stand-in quoting low and a
+* Bybit stand-in quoting high with its own server time, so every scan finds
+* an opportunity, then prints the median of each traced stage and writes
+* the Chrome trace to a temporary file. Also times one trace stamp.
+* usage: bench_opportunity_trace [run_ms=1000] [venue_delay_ms=2]
+*/
+int main(int argc, char** argv) {
+    int runMs = argc > 1 ? std::atoi(argv[1]) : 1000;
+    int delayMs = argc > 2 ? std::atoi(argv[2]) : 2;
+
+    LocalServer binance(std::string(R"({"lastUpdateId":1,"bids":[["100.0","1.0"]],"asks":[["100.5","1.0"]]})"),
+        std::chrono::milliseconds(delayMs));
+    LocalServer bybit([](std::string_view) {
+        return R"({"retCode":0,"retMsg":"OK","result":{"s":"BTCUSDC","a":[["102.5","1.0"]],"b":[["102.0","1.0"]],)"
+            R"("ts":1,"u":1,"seq":1,"cts":1},"retExtInfo":{},"time":)" + std::to_string(wallMs()) + "}";
+    }, std::chrono::milliseconds(delayMs));
+
+    BinanceGateway* low = new BinanceGateway(binance.url("/api/v3"));
+    ByBitGateway* high = new ByBitGateway(bybit.url("/v5"));
+    ArbitrageBot bot(0.005, 1);
+    bot.addExchange(low);
+    bot.addExchange(high);
+
+    // the scan loop prints every scan and opportunity
+    std::ostringstream quiet;
+    auto* console = std::cout.rdbuf(quiet.rdbuf());
+    std::thread scanner([&bot]() { bot.run(Token::BTC, Token::USDC, 1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(runMs));
+    bot.stop();
+    scanner.join();
+    bot.shutdown();
+    std::cout.rdbuf(console);
+
+    const auto traces = bot.opportunityTraces().traces();
+    using T = const OpportunityTrace&;
+    auto buy = [](size_t stage) { return [stage](T t) { return t.buyLeg[stage]; }; };
+    auto sell = [](size_t stage) { return [stage](T t) { return t.sellLeg[stage]; }; };
+    auto lastParse = [](T t) {
+        return std::max(t.buyLeg[OpportunityTrace::PARSED], t.sellLeg[OpportunityTrace::PARSED]);
+    };
+
+    int iterations = 1000000;
+    uint64_t sink = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += traceNow();
+    }
+    double stampNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+
+    char path[] = "/tmp/cexa_traces_XXXXXX.json";
+    int fd = mkstemps(path, 5);
+    if (fd >= 0) {
+        close(fd);
+        std::ofstream out(path);
+        bot.exportTraces(out);
+    }
+
+    std::cout << "opportunities traced            : " << traces.size() << "\n"
+              << "median us, sell exchange to rx  : " << medianMicros(traces, sell(OpportunityTrace::EXCHANGE), sell(OpportunityTrace::RECEIVED)) << "\n"
+              << "median us, buy / sell parse     : "
+              << medianMicros(traces, buy(OpportunityTrace::RECEIVED), buy(OpportunityTrace::PARSED)) << " / "
+              << medianMicros(traces, sell(OpportunityTrace::RECEIVED), sell(OpportunityTrace::PARSED)) << "\n"
+              << "median us, wait for snapshot    : " << medianMicros(traces, lastParse, [](T t) { return t.assembled; }) << "\n"
+              << "median us, evaluate             : " << medianMicros(traces, [](T t) { return t.assembled; }, [](T t) { return t.evaluated; }) << "\n"
+              << "median us, risk check           : " << medianMicros(traces, [](T t) { return t.evaluated; }, [](T t) { return t.riskChecked; }) << "\n"
+              << "median us, log and observers    : " << medianMicros(traces, [](T t) { return t.riskChecked; }, [](T t) { return t.dispatched; }) << "\n"
+              << "median us, first stamp to out   : " << medianMicros(traces, [](T t) { return t.start(); }, [](T t) { return t.dispatched; }) << "\n"
+              << "bybit clock lead estimate us    : " << high->clockLead() / 1000.0 << "\n"
+              << "ns per trace stamp              : " << stampNs << " (" << sink % 2 << ")\n"
+              << "chrome trace                    : " << path << "\n";
+
+    delete low;
+    delete high;
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "common/OrderBook.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// BTC/USDC scale, 4 price and 8 size decimals: a 0.01 tick around 96500
+static constexpr int64_t TICK = 100;
+static constexpr int64_t MID = 965000000;
+static constexpr int64_t ONE = 100000000;
+
+// The node based layout the flat book replaces, for reference
+class MapBook {
+    public:
+        void applySnapshot(OrderBook::Levels bids, OrderBook::Levels asks) {
+            bids_.clear();
+            asks_.clear();
+            for (const auto& level : bids) bids_[level.price] = level.size;
+            for (const auto& level : asks) asks_[level.price] = level.size;
+        }
+
+        void applyDiff(OrderBook::Levels bids, OrderBook::Levels asks) {
+            for (const auto& level : bids) update(bids_, level);
+            for (const auto& level : asks) update(asks_, level);
+        }
+
+        BBO bbo() const {
+            return BBO{
+                PriceLevel{bids_.begin()->first, bids_.begin()->second},
+                PriceLevel{asks_.begin()->first, asks_.begin()->second},
+                0
+            };
+        }
+
+    private:
+        std::map<int64_t, int64_t, std::greater<int64_t>> bids_;
+        std::map<int64_t, int64_t> asks_;
+
+        template<typename Side>
+        static void update(Side& side, const PriceLevel& level) {
+            if (level.size > 0) {
+                side[level.price] = level.size;
+            } else {
+                side.erase(level.price);
+            }
+        }
+};
+
+struct Diff {
+    std::vector<PriceLevel> bids;
+    std::vector<PriceLevel> asks;
+};
+
+// Most activity sits within a few ticks of the touch, about a third are deletes
+static std::vector<Diff> makeDiffs(int count, int levelsPerDiff, std::mt19937& rng) {
+    std::geometric_distribution<int> distance(0.15);
+    std::uniform_int_distribution<int64_t> size(ONE / 1000, 2 * ONE);
+    std::uniform_int_distribution<int> action(0, 2);
+
+    std::vector<Diff> diffs(count);
+    for (auto& diff : diffs) {
+        for (int i = 0; i < levelsPerDiff; i++) {
+            int ticks = std::min(distance(rng), 999) + 1;
+            int64_t qty = action(rng) == 0 ? 0 : size(rng);
+            if (i % 2 == 0) {
+                diff.bids.push_back(PriceLevel{MID - ticks * TICK, qty});
+            } else {
+                diff.asks.push_back(PriceLevel{MID + ticks * TICK, qty});
+            }
+        }
+    }
+    return diffs;
+}
+
+template<typename Apply>
+double updatesPerSecond(const std::vector<Diff>& diffs, int levelsPerDiff, int rounds, Apply&& apply) {
+    auto start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (const auto& diff : diffs) {
+            apply(diff);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(diffs.size()) * levelsPerDiff * rounds / seconds;
+}
+
+template<typename Book>
+double bboNanos(const Book& book, int iterations) {
+    int64_t sink = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        BBO bbo = book.bbo();
+        sink += bbo.bid.price;
+        asm volatile("" : : "g"(&sink) : "memory");
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+/**
+* Single core level update throughput and top of book query cost of the flat
+* OrderBook against a std::map book, over a 1000 level snapshot per side.
+* usage: bench_order_book [diffs=100000] [levels_per_diff=10] [rounds=5]
+*/
+int main(int argc, char** argv) {
+    int count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int levelsPerDiff = argc > 2 ? std::atoi(argv[2]) : 10;
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    std::mt19937 rng(42);
+    std::vector<PriceLevel> bids, asks;
+    for (int i = 1; i <= 1000; i++) {
+        bids.push_back(PriceLevel{MID - i * TICK, ONE});
+        asks.push_back(PriceLevel{MID + i * TICK, ONE});
+    }
+    auto diffs = makeDiffs(count, levelsPerDiff, rng);
+
+    OrderBook flat;
+    flat.applySnapshot(1, bids, asks);
+    uint64_t updateId = 1;
+    auto flatRate = updatesPerSecond(diffs, levelsPerDiff, rounds, [&](const Diff& diff) {
+        updateId++;
+        flat.applyDiff(updateId, updateId, diff.bids, diff.asks);
+    });
+
+    MapBook tree;
+    tree.applySnapshot(bids, asks);
+    auto treeRate = updatesPerSecond(diffs, levelsPerDiff, rounds, [&](const Diff& diff) {
+        tree.applyDiff(diff.bids, diff.asks);
+    });
+
+    std::cout << "level updates              : " << static_cast<long>(count) * levelsPerDiff * rounds << "\n"
+              << "flat book updates / s      : " << flatRate << "\n"
+              << "std::map book updates / s  : " << treeRate << "\n"
+              << "flat book bbo ns           : " << bboNanos(flat, 10000000) << "\n"
+              << "std::map book bbo ns       : " << bboNanos(tree, 10000000) << "\n"
+              << "flat book depth bid / ask  : " << flat.bidDepth() << " / " << flat.askDepth() << "\n";
+    return 0;
+}
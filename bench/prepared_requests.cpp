@@ -0,0 +1,121 @@
+#include "local_server.hpp"
+#include "common/AsyncHttp.hpp"
+#include "common/Instrument.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+
+// Every heap allocation in the process, including the event loop thread
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double submit_ns;       // caller side cost of one submission
+    double allocations;     // whole round trip, both threads
+};
+
+// Submits a burst, then waits for every callback so the next burst starts clean
+template<typename Submit>
+Result run(int iterations, int burst, Submit&& submit) {
+    uint64_t allocations = g_allocations.load();
+    Clock::duration submitting{};
+
+    for (int done = 0; done < iterations; done += burst) {
+        std::atomic<int> remaining{burst};
+        std::promise<void> finished;
+        AsyncHttp::Callback on_complete = [&](AsyncHttp::Response) {
+            if (remaining.fetch_sub(1) == 1) {
+                finished.set_value();
+            }
+        };
+
+        auto start = Clock::now();
+        for (int i = 0; i < burst; i++) {
+            submit(on_complete);
+        }
+        submitting += Clock::now() - start;
+
+        finished.get_future().wait();
+    }
+
+    return Result{
+        static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(submitting).count()) / iterations,
+        static_cast<double>(g_allocations.load() - allocations) / iterations
+    };
+}
+
+/**
+* Per call setup of a depth request built the way getBBO used to, against
+* the same request prepared once and fired repeatedly.
+* usage: bench_prepared_requests [iterations=20000] [burst=100]
+*/
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 20000;
+    int burst = argc > 2 ? std::atoi(argv[2]) : 100;
+    iterations -= iterations % burst;
+
+    LocalServer server(R"({"lastUpdateId":1,"bids":[["96508.10","0.5"]],"asks":[["96508.20","0.25"]]})");
+    const std::string base = server.url("/api/v3");
+
+    AsyncHttp http;
+    http.init(5, static_cast<size_t>(burst) * 2);
+
+    Token buyToken = Token::BTC;
+    Token sellToken = Token::USDC;
+
+    auto adhoc = [&](const AsyncHttp::Callback& on_complete) {
+        std::stringstream ss;
+        ss << buyToken << sellToken;
+        const std::string depthsUrl = base + "/depth?symbol=" + ss.str();
+        std::map<std::string, std::string> headers = {
+            {"Accept", "application/json"}
+        };
+        AsyncHttp::RequestOptions options;
+        options.hedge = true;
+
+        http.get_async(depthsUrl, headers, on_complete, options);
+    };
+
+    AsyncHttp::RequestOptions options;
+    options.hedge = true;
+    const auto prepared = AsyncHttp::prepare_get(base + "/depth?symbol=BTCUSDC",
+        {{"Accept", "application/json"}}, options);
+
+    auto fired = [&](const AsyncHttp::Callback& on_complete) {
+        http.fire_async(prepared, on_complete);
+    };
+
+    // Warm up connections and buffers
+    run(burst * 10, burst, adhoc);
+    run(burst * 10, burst, fired);
+
+    Result before = run(iterations, burst, adhoc);
+    Result after = run(iterations, burst, fired);
+
+    std::cout << "iterations                 : " << iterations << " (bursts of " << burst << ")\n"
+              << "ad hoc   submit ns / call  : " << before.submit_ns << "\n"
+              << "ad hoc   allocations / call: " << before.allocations << "\n"
+              << "prepared submit ns / call  : " << after.submit_ns << "\n"
+              << "prepared allocations / call: " << after.allocations << "\n";
+
+    http.destroy();
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "local_server.hpp"
+#include "binance/BinanceGateway.cpp"
+#include "arber/arber.bot.cpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static std::string depthPayload(int bid) {
+    return R"({"lastUpdateId":1,"bids":[[")" + std::to_string(bid) + R"(.0","1.0"]],)"
+        R"("asks":[[")" + std::to_string(bid) + R"(.5","1.0"]]})";
+}
+
+/**
+* Wall time per scan over four venues answering after 2, 5, 10 and a slow
+* venue's delay: the venues asked one after another against the concurrent
+* snapshot bounded by the scan deadline, then by a quorum of venues.
+* usage: bench_scan_deadline [scans=20] [slow_ms=200] [deadline_ms=50] [quorum=2]
+*/
+int main(int argc, char** argv) {
+    int scans = argc > 1 ? std::atoi(argv[1]) : 20;
+    int slowMs = argc > 2 ? std::atoi(argv[2]) : 200;
+    int deadlineMs = argc > 3 ? std::atoi(argv[3]) : 50;
+    int quorum = argc > 4 ? std::atoi(argv[4]) : 2;
+
+    std::vector<std::unique_ptr<LocalServer>> servers;
+    std::vector<std::unique_ptr<BinanceGateway>> venues;
+    int delays[] = {2, 5, 10, slowMs};
+    for (int i = 0; i < 4; i++) {
+        servers.push_back(std::make_unique<LocalServer>(depthPayload(100 + i), std::chrono::milliseconds(delays[i])));
+        venues.push_back(std::make_unique<BinanceGateway>(servers.back()->url("/api/v3")));
+    }
+
+    ArbitrageBot bot(0.005, 1);
+    bot.setScanDeadline(std::chrono::milliseconds(deadlineMs));
+    for (auto& venue : venues) {
+        bot.addExchange(venue.get());
+        venue->getBBO(Token::BTC, Token::USDC);
+    }
+
+    auto start = Clock::now();
+    int64_t checksum = 0;
+    for (int i = 0; i < scans; i++) {
+        for (auto& venue : venues) {
+            checksum += venue->getBBO(Token::BTC, Token::USDC).bid.price;
+        }
+    }
+    double sequential = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / scans;
+
+    auto timeScans = [&](size_t venuesNeeded, int& found) {
+        bot.setScanQuorum(venuesNeeded);
+        found = 0;
+        auto begin = Clock::now();
+        for (int i = 0; i < scans; i++) {
+            found += bot.scan(Token::BTC, Token::USDC).getExecute();
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / scans;
+    };
+    int found = 0;
+    int foundQuorum = 0;
+    double concurrent = timeScans(0, found);
+    double quorate = timeScans(static_cast<size_t>(quorum), foundQuorum);
+
+    std::cout << "venue delays ms           : 2 5 10 " << slowMs << "\n"
+              << "scan deadline ms          : " << deadlineMs << "\n"
+              << "sequential ms / scan      : " << sequential << "\n"
+              << "concurrent ms / scan      : " << concurrent << "\n"
+              << "scans with opportunity    : " << found << " / " << scans << "\n"
+              << "quorum of " << quorum << " ms / scan     : " << quorate << "\n"
+              << "scans with opportunity    : " << foundQuorum << " / " << scans << "\n"
+              << "checksum                  : " << checksum / scans << "\n";
+
+    for (auto& venue : venues) {
+        venue->destroy();
+    }
+    return 0;
+}
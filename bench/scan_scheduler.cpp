@@ -0,0 +1,141 @@
+#include "local_server.hpp"
+#include "bybit/ByBitGateway.cpp"
+#include "okx/OkxGateway.cpp"
+#include "arber/arber.bot.cpp"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double cpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Whole market tickers, every pair quoted the same except the last, which
+// the OKX stand-in bids above the Bybit ask
+static std::string bybitTickers(int pairs) {
+    std::string body = R"({"retCode":0,"retMsg":"OK","result":{"category":"spot","list":[)";
+    for (int p = 0; p < pairs; p++) {
+        body += (p ? "," : "");
+        body += R"({"symbol":"P)" + std::to_string(p) + R"(USDT","bid1Price":"0.9990","bid1Size":"5",)"
+            R"("ask1Price":"1.0000","ask1Size":"5"})";
+    }
+    return body + "]}}";
+}
+
+static std::string okxTickers(int pairs) {
+    std::string body = R"({"code":"0","msg":"","data":[)";
+    for (int p = 0; p < pairs; p++) {
+        const char* bid = p == pairs - 1 ? "1.0100" : "0.9990";
+        body += (p ? "," : "");
+        body += R"({"instId":"P)" + std::to_string(p) + R"(-USDT","bidPx":")" + bid + R"(","bidSz":"5",)"
+            R"("askPx":"1.0000","askSz":"5","ts":"1"})";
+    }
+    return body + "]}";
+}
+
+struct Run {
+    double requestsPerSecond;
+    double cpuPerSecond;
+    double crossingPerSecond;
+    // from start to the first scan that saw the crossed pair, NaN if none did
+    double firstSeenMs;
+};
+
+// Time for every cold pair to come round once: the cold batches of a sweep,
+// each round adding its hot batch, one batch per worker per interval
+static int coldSweepMs(int pairs, const ScanScheduler::Config& config, int intervalMs, size_t workers) {
+    size_t cold = pairs > static_cast<int>(config.hotPairs) ? pairs - config.hotPairs : 0;
+    size_t coldBatches = (cold + config.coldBatch - 1) / config.coldBatch;
+    size_t batches = coldBatches + (coldBatches + config.coldPerRound - 1) / config.coldPerRound;
+    return static_cast<int>(batches * intervalMs / workers);
+}
+
+static Run scan(int pairs, bool scheduled, int runMs, int intervalMs, size_t workers) {
+    LocalServer bybit(bybitTickers(pairs));
+    LocalServer okx(okxTickers(pairs));
+    ByBitGateway* low = new ByBitGateway(bybit.url("/v5"));
+    OkxGateway* high = new OkxGateway(okx.url("/api/v5"));
+    ArbitrageBot bot(0.005, 1);
+    // OKX stamps its entries with ts 1, the age check is not what is measured
+    bot.setMaxQuoteAge(std::chrono::hours(24 * 365 * 100));
+    bot.addExchange(low);
+    bot.addExchange(high);
+
+    std::vector<Instrument> instruments;
+    for (int p = 0; p < pairs; p++) {
+        Token base = TokenTable::shared().intern("P" + std::to_string(p));
+        instruments.emplace_back(base, Token::USDT, Exchange::BYBIT, FeedType::SPOT);
+    }
+    ScanScheduler::Config config;
+    if (!scheduled) {
+        // every pair in every scan
+        config.hotPairs = instruments.size();
+    }
+
+    std::ostringstream quiet;
+    auto* console = std::cout.rdbuf(quiet.rdbuf());
+    uint64_t served = bybit.served() + okx.served();
+    double cpu = cpuSeconds();
+    auto start = Clock::now();
+    std::thread scanner([&]() { bot.run(instruments, intervalMs, workers, config); });
+    // long enough for the crossed pair, listed last, to come round twice
+    const auto until = start + std::chrono::milliseconds(std::max(runMs, 2 * coldSweepMs(pairs, config, intervalMs, workers)));
+    double firstSeenMs = std::nan("");
+    while (Clock::now() < until) {
+        if (std::isnan(firstSeenMs) && bot.opportunityTraces().recorded() > 0) {
+            firstSeenMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bot.stop();
+    scanner.join();
+    bot.shutdown();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout.rdbuf(console);
+
+    Run run{(bybit.served() + okx.served() - served) / seconds, (cpuSeconds() - cpu) / seconds,
+            bot.opportunityTraces().recorded() / seconds, firstSeenMs};
+    delete low;
+    delete high;
+    return run;
+}
+
+/**
+* Two workers scanning a growing set of pairs over Bybit and OKX stand-ins
+* answering with the whole market, one pair crossed and listed last. Every
+* pair in every scan against the scheduler's hot set plus cold batches:
+* requests and CPU per second, how long until the crossed pair is first seen
+* and how often it is seen after. Each run lasts run_ms or two cold sweeps,
+* whichever is longer.
+* usage: bench_scan_scheduler [run_ms=2000] [interval_ms=100] [workers=2]
+*/
+int main(int argc, char** argv) {
+    int runMs = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int intervalMs = argc > 2 ? std::atoi(argv[2]) : 100;
+    size_t workers = argc > 3 ? std::atoi(argv[3]) : 2;
+
+    std::cout << "pairs   mode        requests/s  cpu %   first seen ms  crossed pair seen/s\n";
+    for (int pairs : {16, 256, 4096}) {
+        for (bool scheduled : {false, true}) {
+            Run run = scan(pairs, scheduled, runMs, intervalMs, workers);
+            std::cout << std::left << std::setw(8) << pairs << std::setw(12) << (scheduled ? "scheduled" : "all")
+                      << std::setw(12) << run.requestsPerSecond << std::setw(8) << run.cpuPerSecond * 100
+                      << std::setw(15) << run.firstSeenMs << run.crossingPerSecond << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "local_server.hpp"
+#include "local_ws_server.hpp"
+#include "binance/BinanceGateway.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static const char* DEPTH_PAYLOAD =
+    R"({"lastUpdateId":58373620913,)"
+    R"("bids":[["96508.10000000","0.52010000"],["96508.00000000","0.00006000"]],)"
+    R"("asks":[["96508.11000000","0.25730000"],["96508.12000000","0.00012000"]]})";
+
+using Clock = std::chrono::steady_clock;
+
+// Exposes whether the gateway would answer from the stream
+class StreamedBinanceGateway : public BinanceGateway {
+    public:
+        using BinanceGateway::BinanceGateway;
+        bool streaming(Token buyToken, Token sellToken) const {
+            return streamedBBO(buyToken, sellToken).has_value();
+        }
+};
+
+struct Latency {
+    double mean_us;
+    double p99_us;
+};
+
+Latency measure(Gateway& gateway, int iterations) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (int i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        gateway.getBBO(Token::BTC, Token::USDC);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    return Latency{total / iterations, samples[samples.size() * 99 / 100]};
+}
+
+/**
+* getBBO over REST against getBBO served from a bookTicker stream, then how
+* long the gateway falls back to REST after the feed drops every connection.
+* usage: bench_stream_bbo [iterations=2000] [tick_us=500]
+*/
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int tick_us = argc > 2 ? std::atoi(argv[2]) : 500;
+
+    LocalServer rest(DEPTH_PAYLOAD);
+    LocalWebSocketServer feed({
+        R"({"u":400900217,"s":"BTCUSDC","b":"96508.10000000","B":"0.52010000","a":"96508.11000000","A":"0.25730000"})",
+        R"({"u":400900218,"s":"BTCUSDC","b":"96508.00000000","B":"0.10000000","a":"96508.12000000","A":"0.00012000"})"
+    }, std::chrono::microseconds(tick_us));
+
+    StreamedBinanceGateway gateway(rest.url("/api/v3"), feed.url("/ws"));
+
+    auto rest_latency = measure(gateway, iterations);
+
+    gateway.subscribe(Token::BTC, Token::USDC);
+    auto subscribed = Clock::now();
+    while (!gateway.streaming(Token::BTC, Token::USDC)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    auto first_quote_ms = std::chrono::duration<double, std::milli>(Clock::now() - subscribed).count();
+
+    uint64_t served = rest.served();
+    auto stream_latency = measure(gateway, iterations);
+    uint64_t rest_during_stream = rest.served() - served;
+
+    // Keep calling getBBO through the outage, every call until recovery goes to REST
+    feed.drop_all();
+    auto dropped = Clock::now();
+    while (gateway.streaming(Token::BTC, Token::USDC)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    served = rest.served();
+    int calls = 0;
+    while (!gateway.streaming(Token::BTC, Token::USDC)) {
+        gateway.getBBO(Token::BTC, Token::USDC);
+        calls++;
+    }
+    auto recovery_ms = std::chrono::duration<double, std::milli>(Clock::now() - dropped).count();
+
+    std::cout << "iterations                 : " << iterations << "\n"
+              << "rest   getBBO mean / p99 us: " << rest_latency.mean_us << " / " << rest_latency.p99_us << "\n"
+              << "stream getBBO mean / p99 us: " << stream_latency.mean_us << " / " << stream_latency.p99_us << "\n"
+              << "rest requests while live   : " << rest_during_stream << "\n"
+              << "first quote after subscribe: " << first_quote_ms << " ms\n"
+              << "recovery after drop        : " << recovery_ms << " ms (" << calls << " getBBO calls, "
+              << rest.served() - served << " over REST)\n"
+              << "connections / subscriptions: " << feed.connections() << " / " << feed.subscriptions() << "\n";
+
+    gateway.destroy();
+    return 0;
+}
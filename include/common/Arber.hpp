@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AsyncHttp.hpp"
+#include "FixedPoint.hpp"
 #include "Instrument.hpp"
 #include "config.hpp"
 
@@ -19,6 +20,12 @@ class Arber {
         double amount;
         BBO buyBBO;
         BBO sellBBO;
+        // the BBOs are in this pair's ticks and lots
+        PairScale scale;
+        // steady_clock ns when the scan's snapshot was assembled and when
+        // this pair was evaluated, 0 when not traced
+        uint64_t assembledAt = 0;
+        uint64_t evaluatedAt = 0;
 
         Arber(
             Token buyToken,
@@ -30,12 +37,16 @@ class Arber {
             BBO buyBBO,
             BBO sellBBO,
             bool execute = true
-        ) : buyToken(buyToken), sellToken(sellToken),
+        ) : execute(execute), buyToken(buyToken), sellToken(sellToken),
             buyExchange(buyExchange), sellExchange(sellExchange),
             profit(profit), amount(amount),
-            sellBBO(sellBBO), buyBBO(buyBBO), execute(execute) {}
+            buyBBO(buyBBO), sellBBO(sellBBO), scale(scaleOf(buyToken, sellToken)) {}
 
         bool getExecute() const { return execute; }
+
+        double buyPrice() const { return scale.price(buyBBO.ask.price); }
+        double sellPrice() const { return scale.price(sellBBO.bid.price); }
+        double spread() const { return scale.price(sellBBO.bid.price - buyBBO.ask.price); }
 };
 
 class IExchange {
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "HttpBuffer.hpp"
+#include "LatencyRecorder.hpp"
+#include "RateLimiter.hpp"
+
 #include <curl/curl.h>
 #include <string>
 #include <cstddef>
@@ -10,30 +14,104 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
-#include <queue>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <array>
+#include <chrono>
+#include <coroutine>
 #include <thread>
-#include <condition_variable>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <type_traits>
+#include <stdexcept>
+
+
+// Dispatch priority when connections are scarce, first lane goes first
+enum class HttpLane {
+    MARKET_DATA,
+    // listings, webhooks: whatever can wait behind market data
+    REFERENCE
+};
 
+// Per request knobs, defined outside AsyncHttp so they can be default arguments
+struct HttpRequestOptions {
+    HttpLane lane = HttpLane::MARKET_DATA;
+    // How long the request may wait in its lane for a free connection
+    std::chrono::milliseconds queue_timeout{1000};
+    // Response headers are only parsed and stored when asked for
+    bool collect_headers = false;
+    // Budget for the whole transfer once it has a connection, hedge included
+    std::chrono::milliseconds timeout{500};
+    std::chrono::milliseconds connect_timeout{300};
+    // Idempotent GETs only: once the first attempt is slower than this
+    // percentile of recent round trips, race a duplicate on another connection.
+    // No duplicate goes out while requests wait in a lane.
+    bool hedge = false;
+    double hedge_percentile = 0.95;
+    // Cost against the venue's rate limit, a hedge pays it again
+    uint32_t weight = 1;
+    // GETs only: a request for a URL already queued or in flight rides along
+    // with it and gets the same response instead of going out again
+    bool coalesce = false;
+};
 
 /**
-* @brief Multi worker Async http request class
+* @brief Async http request class driven by a single curl_multi event loop.
+* Every pooled connection can be in flight at once.
 */
 class AsyncHttp {
     public:
+        // body and headers share one pooled buffer, recycled once both are dropped.
+        // A transfer that got no answer has status_code -1 and why in body.
         struct Response {
-            long status_code;
-            std::string body;
-            std::string error;
-            std::map<std::string, std::string> headers;
+            long status_code = 0;
+            HttpBody body;
+            HttpHeaders headers;
+            // the request's endpoint histograms while a LatencyRecorder is set,
+            // so the caller can add its parse time
+            EndpointLatency* latency = nullptr;
+            // steady_clock ns when the transfer finished, 0 when it failed
+            uint64_t received_at = 0;
         };
 
         enum class Method {
             GET,
-            POST
+            POST,
+            HEAD
+        };
+
+        using Lane = HttpLane;
+        using RequestOptions = HttpRequestOptions;
+        static constexpr size_t LANE_COUNT = 2;
+
+        struct LaneStats {
+            size_t depth;               // waiting right now
+            uint64_t enqueued;
+            uint64_t dispatched;
+            uint64_t rejected;          // lane was full
+            uint64_t expired;           // waited past queue_timeout
+            uint64_t total_wait_us;     // over dispatched requests
+            uint64_t max_wait_us;
+        };
+
+        // Plain atomics, readable at any time without holding up the loop
+        struct LoadStats {
+            size_t queued;              // waiting in any lane
+            size_t busy;                // pooled connections in use
+            size_t pool_size;
+            uint64_t completed;         // responses handed back, failures included
+            uint64_t failed;            // no HTTP answer, or a status of 400 and up
+        };
+
+        struct HedgeStats {
+            uint64_t fired;     // duplicates sent
+            uint64_t won;       // duplicates that answered first
         };
 
+        // Invoked on the event loop thread once a request finishes
+        using Callback = std::function<void(Response)>;
+
         AsyncHttp();
         ~AsyncHttp();
 
@@ -42,43 +120,207 @@ class AsyncHttp {
         AsyncHttp& operator=(const AsyncHttp&) = delete;
 
         std::future<Response> get_raw(const std::string& url,
-            const std::map<std::string, std::string>& headers = {});
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
 
         std::future<Response> post_raw(const std::string& url, const nlohmann::json& json_body,
-            const std::map<std::string, std::string>& headers = {});
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
+
+        // Continuation flavour, nothing blocks and no thread is created
+        void get_async(const std::string& url,
+            const std::map<std::string, std::string>& headers,
+            Callback on_complete,
+            const RequestOptions& options = {});
+
+        void post_async(const std::string& url, const nlohmann::json& json_body,
+            const std::map<std::string, std::string>& headers,
+            Callback on_complete,
+            const RequestOptions& options = {});
 
+        class RequestAwaiter;
+        class PreparedRequest;
+
+        // co_await-able flavour, the coroutine resumes on the event loop thread
+        RequestAwaiter co_get(const std::string& url,
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
+
+        RequestAwaiter co_post(const std::string& url, const nlohmann::json& json_body,
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
+
+        // Builds the URL, header list and options of a hot request once
+        static PreparedRequest prepare_get(const std::string& url,
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
+
+        static PreparedRequest prepare_post(const std::string& url, const nlohmann::json& json_body,
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
+
+        // Fire a prepared request, nothing is copied or rebuilt per call.
+        // The prepared request must outlive every request fired from it.
+        std::future<Response> fire(const PreparedRequest& prepared);
+        void fire_async(const PreparedRequest& prepared, Callback on_complete);
+        RequestAwaiter co_fire(const PreparedRequest& prepared);
+
+        // Typed requests, parse<T> runs on the event loop thread
         template<typename T>
         std::future<T> get(const std::string& url,
-            const std::map<std::string, std::string>& headers = {});
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
 
         template<typename T>
         std::future<T> post(const std::string& url,
             const nlohmann::json& json_body,
-            const std::map<std::string, std::string>& headers = {});
+            const std::map<std::string, std::string>& headers = {},
+            const RequestOptions& options = {});
 
         // Method to parse the body
         template<typename T>
         static T parse(const Response& response);
 
-        void init(size_t pool_size = 10);
+        // queue_capacity bounds each lane, requests beyond it fail straight away
+        void init(size_t pool_size = 10, size_t queue_capacity = 256);
         void destroy();
 
+        // Opens every pooled connection with a concurrent HEAD to url, so DNS,
+        // TCP and TLS are paid before the first real request. Blocks until all
+        // of them answered or timed out, returns how many got an HTTP status.
+        size_t prewarm(const std::string& url,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
+
+        // Every dispatch and hedge asks the limiter first, every response is
+        // fed back to it. Headers are collected whenever one is set.
+        void set_rate_limiter(std::shared_ptr<RateLimiter> limiter);
+
+        // Every completed request files its queue wait and curl phase timings
+        // under its endpoint in the recorder
+        void set_latency_recorder(std::shared_ptr<LatencyRecorder> recorder);
+        std::shared_ptr<LatencyRecorder> latency_recorder() const;
+
+        LaneStats lane_stats(Lane lane) const;
+        LoadStats load_stats() const;
+        HedgeStats hedge_stats() const;
+        // Requests answered by another one's transfer
+        uint64_t coalesced() const;
+
     private:
+        struct Transfer;
+
+        // One try of a transfer on one pooled connection
+        struct Attempt {
+            CURL* conn = nullptr;
+            Transfer* transfer = nullptr;
+            // leased from buffers_ when the attempt starts
+            HttpBufferRef buffer;
+            std::chrono::steady_clock::time_point started;
+        };
+
+        // A single request travelling through the multi handle
+        struct Transfer {
+            std::string url;
+            Method method = Method::GET;
+            std::string body;
+            struct curl_slist* headers = nullptr;
+            // when set, url, body and headers come from here instead
+            const PreparedRequest* prepared = nullptr;
+            bool collect_headers = false;
+            // completion goes to on_complete when set, otherwise to promise
+            Callback on_complete;
+            // only engaged for future based requests, a promise allocates
+            std::optional<std::promise<Response>> promise;
+            Lane lane = Lane::MARKET_DATA;
+            std::chrono::steady_clock::time_point enqueued_at;
+            std::chrono::steady_clock::time_point queue_deadline;
+            std::chrono::steady_clock::time_point dispatched_at;
+            std::chrono::milliseconds timeout;
+            std::chrono::milliseconds connect_timeout;
+            bool hedge = false;
+            double hedge_percentile = 0.95;
+            uint32_t weight = 1;
+            bool coalesce = false;
+            // registered in coalescing_, followers get a copy of the response
+            bool leading = false;
+            std::vector<std::unique_ptr<Transfer>> followers;
+            // set once a connection is assigned
+            std::chrono::steady_clock::time_point deadline;
+            std::chrono::steady_clock::time_point hedge_at;
+            // primary attempt and, when hedged, its duplicate
+            std::array<Attempt, 2> attempts;
+            size_t launched = 0;
+            size_t running = 0;
+        };
+
         CURLM* multi_handle_;
         std::vector<CURL*> connection_pool_;
+        size_t pool_size_ = 0;
         std::mutex pool_mutex_;
+        // response buffers, recycled alongside the connections
+        std::shared_ptr<HttpBufferPool> buffers_;
 
-        // threads for processing requests
+        // event loop driving every transfer through multi_handle_
         std::thread worker_thread_;
-        // denotes if a request is running
+        // denotes if the event loop is running
         std::atomic<bool> running_;
-        std::queue<std::function<void()>> task_queue_;
-        std::mutex queue_mutex_;
-        // condvar as in rust
-        std::condition_variable cv_;
+        // submitted requests waiting for a free connection, one queue per lane
+        std::array<std::deque<std::unique_ptr<Transfer>>, LANE_COUNT> lanes_;
+        std::array<LaneStats, LANE_COUNT> lane_stats_{};
+        // mirrors of the lane and pool sizes for load_stats
+        std::atomic<size_t> queued_{0};
+        std::atomic<size_t> busy_{0};
+        std::atomic<uint64_t> completed_{0};
+        std::atomic<uint64_t> failed_{0};
+        size_t queue_capacity_;
+        mutable std::mutex queue_mutex_;
+        // requests currently attached to multi_handle_, owned by the loop
+        std::vector<Transfer*> in_flight_;
+        // set under queue_mutex_, the loop picks it up once per pass
+        std::shared_ptr<RateLimiter> rate_limiter_;
+        std::shared_ptr<RateLimiter> loop_limiter_;
+        // same pattern as the limiter
+        std::shared_ptr<LatencyRecorder> latency_recorder_;
+        std::shared_ptr<LatencyRecorder> loop_latency_;
+        // where endpointOf folds ids, only touched by the loop
+        std::string endpoint_scratch_;
+
+        // recent successful round trips in us, only touched by the loop
+        std::array<uint32_t, 256> latency_window_{};
+        size_t latency_samples_ = 0;
+        std::atomic<uint64_t> hedges_fired_{0};
+        std::atomic<uint64_t> hedges_won_{0};
+        // leader per URL, keys view into the leader's own URL, under queue_mutex_
+        std::unordered_map<std::string_view, Transfer*> coalescing_;
+        std::atomic<uint64_t> coalesced_{0};
 
         // Internal request processing function
         void worker_loop();
+        // Attach queued requests to free connections, highest priority lane first.
+        // Returns ms until the rate limiter lets the next one through.
+        long start_pending();
+        // Fail queued requests past their deadline, returns ms until the next one
+        long expire_queued();
+        // Collect finished transfers from the multi handle, returns how many
+        size_t finish_completed();
+        // Configure a pooled handle for the transfer and attach it
+        bool launch_attempt(Transfer* transfer, CURL* conn);
+        // Hand an attempt's connection back, detaching it first if still running
+        void release_attempt(Attempt& attempt, bool detach);
+        // Race duplicates for slow hedged transfers, returns ms until the next is due
+        long fire_hedges();
+        void record_latency(std::chrono::steady_clock::duration elapsed);
+        // Queue wait and curl's phase timers of a finished transfer
+        void record_phases(const Transfer& transfer, CURL* conn, EndpointLatency& latency);
+        std::chrono::microseconds latency_percentile(double percentile) const;
+        // Resolve a transfer from its winning attempt, or with an error when
+        // winner is null. reason overrides the curl error text.
+        void complete(Transfer* transfer, Attempt* winner, CURLcode result, const char* reason = nullptr);
+        // Hands a response to the transfer's promise or callback
+        void deliver(Transfer& transfer, Response response);
+        static std::string_view url_of(const Transfer& transfer);
+        // Fail everything still queued or in flight on shutdown
+        void abort_all();
         // Get the connection from pool
         CURL* get_connection();
         void return_connection(CURL* conn);
@@ -86,8 +328,128 @@ class AsyncHttp {
         std::future<Response> request(const std::string& url,
                                         const Method& method,
                                         const std::string& body,
-                                        const std::map<std::string, std::string>& headers);
+                                        const std::map<std::string, std::string>& headers,
+                                        const RequestOptions& options);
+
+        std::unique_ptr<Transfer> make_transfer(const std::string& url,
+                                        const Method& method,
+                                        const std::string& body,
+                                        const std::map<std::string, std::string>& headers,
+                                        const RequestOptions& options);
+        std::unique_ptr<Transfer> make_transfer(const PreparedRequest& prepared);
+        static void apply_options(Transfer& transfer, const RequestOptions& options);
+        // Fails a transfer that never got a connection
+        void reject(std::unique_ptr<Transfer> transfer, const std::string& reason);
+        // Queue a transfer and wake the event loop, fails it once destroy() began
+        void submit(std::unique_ptr<Transfer> transfer);
+        // Files the transfer in its lane or with its coalescing leader, leaves
+        // it in place when the lane is full. Under queue_mutex_.
+        void enqueue(std::unique_ptr<Transfer>& transfer);
+
+        static std::string json_body_of(const nlohmann::json& json_body);
+        static std::map<std::string, std::string> json_headers_of(
+            const std::map<std::string, std::string>& headers);
+
+        // Resolves a typed promise from a raw response
+        template<typename T>
+        static Callback typed_completion(std::shared_ptr<std::promise<T>> promise);
 
         static size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
         static size_t header_callback(char* buffer, size_t size, size_t nitems, void* userdata);
 };
+
+// The request is only submitted once the awaiting coroutine is suspended
+class AsyncHttp::RequestAwaiter {
+    public:
+        RequestAwaiter(AsyncHttp& http, std::unique_ptr<Transfer> transfer)
+            : http_(http), transfer_(std::move(transfer)) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        Response await_resume() { return std::move(response_); }
+
+    private:
+        AsyncHttp& http_;
+        std::unique_ptr<Transfer> transfer_;
+        Response response_;
+};
+
+class AsyncHttp::PreparedRequest {
+    public:
+        PreparedRequest(Method method, std::string url, std::string body,
+            const std::map<std::string, std::string>& headers, const RequestOptions& options);
+        ~PreparedRequest();
+
+        PreparedRequest(PreparedRequest&& other) noexcept;
+        PreparedRequest& operator=(PreparedRequest&& other) noexcept;
+
+        PreparedRequest(const PreparedRequest&) = delete;
+        PreparedRequest& operator=(const PreparedRequest&) = delete;
+
+        const std::string& url() const { return url_; }
+        const RequestOptions& options() const { return options_; }
+
+    private:
+        friend class AsyncHttp;
+
+        Method method_;
+        std::string url_;
+        std::string body_;
+        // shared read only by every transfer fired from this request
+        struct curl_slist* headers_ = nullptr;
+        RequestOptions options_;
+};
+
+template<typename T>
+std::future<T> AsyncHttp::get(const std::string& url,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options) {
+    auto promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+
+    get_async(url, headers, typed_completion<T>(std::move(promise)), options);
+
+    return future;
+}
+
+template<typename T>
+std::future<T> AsyncHttp::post(const std::string& url,
+    const nlohmann::json& json_body,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options) {
+    auto promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+
+    post_async(url, json_body, headers, typed_completion<T>(std::move(promise)), options);
+
+    return future;
+}
+
+template<typename T>
+AsyncHttp::Callback AsyncHttp::typed_completion(std::shared_ptr<std::promise<T>> promise) {
+    return [promise = std::move(promise)](Response response) {
+        try {
+            if (response.status_code >= 200 && response.status_code < 300) {
+                promise->set_value(parse<T>(response));
+            } else {
+                std::string error_msg = "HTTP error: " + std::to_string(response.status_code);
+                if (!response.body.empty()) {
+                    error_msg += " - ";
+                    error_msg += response.body.view();
+                }
+                promise->set_exception(std::make_exception_ptr(std::runtime_error(error_msg)));
+            }
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    };
+}
+
+// Generic template
+template<typename T>
+T AsyncHttp::parse(const Response &response) {
+    throw std::runtime_error("No parser implemented for this type");
+}
+
+template<>
+nlohmann::json AsyncHttp::parse<nlohmann::json>(const Response& response);
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "FixedPoint.hpp"
+#include "config.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+* @brief Allocation free extraction of the few fields a depth or ticker
+* payload is read for. Keys are located by scanning the raw body (memchr and
+* string_view::find, both vectorised in libc) and only the values asked for
+* are touched. Numbers come back as their wire text, PairScale turns them
+* into exact fixed point.
+*
+* This is not a JSON validator. It relies on the venue schemas: keys are
+* unique wherever they are looked up, and level arrays hold flat arrays
+* whose first two elements are price and size, quoted or not.
+*/
+class DepthParser {
+    public:
+        // Calls onLevel(price, size) with the wire text of each level under key
+        // until it returns false. False when the key is missing or the array is malformed.
+        template<typename OnLevel>
+        static bool levels(std::string_view body, std::string_view key, OnLevel&& onLevel) {
+            const char* p = value(body, key);
+            const char* end = body.data() + body.size();
+            if (!p || !expect(p, end, '[')) {
+                return false;
+            }
+
+            skipSpace(p, end);
+            if (p < end && *p == ']') {
+                return true;
+            }
+
+            while (p < end) {
+                std::string_view price, size;
+                if (!expect(p, end, '[') || !number(p, end, price) ||
+                    !expect(p, end, ',') || !number(p, end, size)) {
+                    return false;
+                }
+
+                // skip anything past size, e.g. order counts
+                p = static_cast<const char*>(std::memchr(p, ']', end - p));
+                if (!p) {
+                    return false;
+                }
+                p++;
+
+                if (!onLevel(price, size)) {
+                    return true;
+                }
+
+                skipSpace(p, end);
+                if (p < end && *p == ']') {
+                    return true;
+                }
+                if (!expect(p, end, ',')) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        // Calls onObject(text) for each object of the array under key, or of the
+        // top level array when key is empty, until it returns false
+        template<typename OnObject>
+        static bool objects(std::string_view body, std::string_view key, OnObject&& onObject) {
+            const char* p = key.empty() ? body.data() : value(body, key);
+            const char* end = body.data() + body.size();
+            if (!p || !expect(p, end, '[')) {
+                return false;
+            }
+
+            skipSpace(p, end);
+            if (p < end && *p == ']') {
+                return true;
+            }
+
+            while (p < end) {
+                if (!expect(p, end, '{')) {
+                    return false;
+                }
+                const char* start = p - 1;
+                p = closing(p, end);
+                if (!p) {
+                    return false;
+                }
+
+                if (!onObject(std::string_view(start, p - start))) {
+                    return true;
+                }
+
+                skipSpace(p, end);
+                if (p < end && *p == ']') {
+                    return true;
+                }
+                if (!expect(p, end, ',')) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        // Levels under key at scale, false on a malformed or unrepresentable level
+        template<typename OnLevel>
+        static bool levels(std::string_view body, std::string_view key, PairScale scale, OnLevel&& onLevel) {
+            bool exact = true;
+            bool ok = levels(body, key, [&](std::string_view price, std::string_view size) {
+                PriceLevel level;
+                exact = scale.parseLevel(price, size, level);
+                return exact && onLevel(level);
+            });
+            return ok && exact;
+        }
+
+        // Best level under key, false when missing, empty or malformed
+        static bool top(std::string_view body, std::string_view key, PairScale scale, PriceLevel& out) {
+            bool found = false;
+            bool ok = levels(body, key, scale, [&](const PriceLevel& level) {
+                out = level;
+                found = true;
+                return false;
+            });
+            return ok && found;
+        }
+
+        // Wire text of a number under key, quoted or bare
+        static bool decimal(std::string_view body, std::string_view key, std::string_view& out) {
+            const char* p = value(body, key);
+            return p && number(p, body.data() + body.size(), out);
+        }
+
+        static bool integer(std::string_view body, std::string_view key, uint64_t& out) {
+            const char* p = value(body, key);
+            const char* end = body.data() + body.size();
+            if (!p) {
+                return false;
+            }
+            bool quoted = p < end && *p == '"';
+            auto result = std::from_chars(p + quoted, end, out);
+            return result.ec == std::errc();
+        }
+
+        // The raw contents of a string value, escapes are not decoded
+        static bool string(std::string_view body, std::string_view key, std::string_view& out) {
+            const char* p = value(body, key);
+            const char* end = body.data() + body.size();
+            if (!p || p >= end || *p != '"') {
+                return false;
+            }
+            p++;
+            const char* close = static_cast<const char*>(std::memchr(p, '"', end - p));
+            if (!close) {
+                return false;
+            }
+            out = std::string_view(p, close - p);
+            return true;
+        }
+
+    private:
+        // First character of the value stored under key, nullptr when absent
+        static const char* value(std::string_view body, std::string_view key) {
+            const char* end = body.data() + body.size();
+            size_t at = 0;
+            while ((at = body.find(key, at)) != std::string_view::npos) {
+                size_t after = at + key.size();
+                if (at > 0 && body[at - 1] == '"' && after < body.size() && body[after] == '"') {
+                    const char* p = body.data() + after + 1;
+                    if (expect(p, end, ':')) {
+                        skipSpace(p, end);
+                        return p;
+                    }
+                }
+                at = after;
+            }
+            return nullptr;
+        }
+
+        // Just past the brace closing the object opened right before p
+        static const char* closing(const char* p, const char* end) {
+            int depth = 1;
+            while (p < end) {
+                char c = *p++;
+                if (c == '"') {
+                    while (p < end && *p != '"') {
+                        p += (*p == '\\' && p + 1 < end) ? 2 : 1;
+                    }
+                    if (p == end) {
+                        return nullptr;
+                    }
+                    p++;
+                } else if (c == '{' || c == '[') {
+                    depth++;
+                } else if ((c == '}' || c == ']') && --depth == 0) {
+                    return p;
+                }
+            }
+            return nullptr;
+        }
+
+        static void skipSpace(const char*& p, const char* end) {
+            while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+                p++;
+            }
+        }
+
+        static bool expect(const char*& p, const char* end, char c) {
+            skipSpace(p, end);
+            if (p < end && *p == c) {
+                p++;
+                return true;
+            }
+            return false;
+        }
+
+        static bool number(const char*& p, const char* end, std::string_view& out) {
+            skipSpace(p, end);
+            if (p < end && *p == '"') {
+                const char* close = static_cast<const char*>(std::memchr(p + 1, '"', end - p - 1));
+                if (!close) {
+                    return false;
+                }
+                out = std::string_view(p + 1, close - p - 1);
+                p = close + 1;
+                return true;
+            }
+
+            const char* last = p;
+            while (last < end && ((*last >= '0' && *last <= '9') || *last == '.' || *last == '-' ||
+                                  *last == '+' || *last == 'e' || *last == 'E')) {
+                last++;
+            }
+            if (last == p) {
+                return false;
+            }
+            out = std::string_view(p, last - p);
+            p = last;
+            return true;
+        }
+};
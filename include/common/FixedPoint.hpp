@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Instrument.hpp"
+#include "KeyIndex.hpp"
+#include "config.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+/**
+* @brief Decimal places a pair's prices and sizes are held at. Wire strings
+* convert straight to integers at this scale, so comparisons and spreads are
+* exact integer math and doubles only show up in ratios and for display.
+*/
+struct PairScale {
+    uint8_t priceDecimals;
+    uint8_t sizeDecimals;
+
+    double price(int64_t ticks) const { return static_cast<double>(ticks) / pow10(priceDecimals); }
+    double size(int64_t lots) const { return static_cast<double>(lots) / pow10(sizeDecimals); }
+
+    // price * size in the quote token, the product is taken in 128 bits
+    double notional(const PriceLevel& level) const {
+        __int128 product = static_cast<__int128>(level.price) * level.size;
+        return static_cast<double>(product) / (pow10(priceDecimals) * pow10(sizeDecimals));
+    }
+
+    int64_t ticks(double price) const { return static_cast<int64_t>(price * pow10(priceDecimals) + (price < 0 ? -0.5 : 0.5)); }
+    int64_t lots(double size) const { return static_cast<int64_t>(size * pow10(sizeDecimals) + (size < 0 ? -0.5 : 0.5)); }
+
+    bool parseLevel(std::string_view price, std::string_view size, PriceLevel& out) const {
+        return parseFixed(price, priceDecimals, out.price) && parseFixed(size, sizeDecimals, out.size);
+    }
+
+    // Exact decimal text to an integer count of 10^-decimals. Digits past the
+    // scale must be zeros, anything finer would not be exact and is refused.
+    static bool parseFixed(std::string_view text, unsigned decimals, int64_t& out) {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        bool negative = p < end && *p == '-';
+        p += negative;
+        if (p == end) {
+            return false;
+        }
+
+        constexpr int64_t LIMIT = std::numeric_limits<int64_t>::max() / 10;
+        int64_t value = 0;
+        unsigned fraction = 0;
+        bool point = false;
+        bool digits = false;
+        for (; p < end; p++) {
+            if (*p == '.' && !point) {
+                point = true;
+                continue;
+            }
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+            digits = true;
+            if (point && fraction == decimals) {
+                if (*p != '0') {
+                    return false;
+                }
+                continue;
+            }
+            int digit = *p - '0';
+            if (value > (std::numeric_limits<int64_t>::max() - digit) / 10) {
+                return false;
+            }
+            value = value * 10 + digit;
+            fraction += point;
+        }
+
+        if (!digits) {
+            return false;
+        }
+        for (; fraction < decimals; fraction++) {
+            if (value > LIMIT) {
+                return false;
+            }
+            value *= 10;
+        }
+        out = negative ? -value : value;
+        return true;
+    }
+
+    // Decimal places of a venue's tick or lot step as it sends it,
+    // "0.01000000" is 2 and "10" is 0
+    static uint8_t decimalsOf(std::string_view step) {
+        size_t dot = step.find('.');
+        if (dot == std::string_view::npos) {
+            return 0;
+        }
+        size_t last = step.find_last_not_of('0');
+        return last == std::string_view::npos || last <= dot ? 0 :
+            static_cast<uint8_t>(std::min<size_t>(last - dot, MAX_DECIMALS));
+    }
+
+    // finer steps are clamped, so ticks and lots of real prices and sizes
+    // stay well inside int64
+    static constexpr uint8_t MAX_DECIMALS = 9;
+
+    static double pow10(unsigned n) {
+        static constexpr double POW10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+            1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+        };
+        return POW10[n];
+    }
+};
+
+/**
+* @brief Scales of the pairs the instrument universe loaded, fine enough for
+* every venue's tick and lot of the pair. Set at startup, read lock free.
+*/
+class PairScales {
+    public:
+        static PairScales& shared() {
+            static PairScales scales;
+            return scales;
+        }
+
+        void set(Token base, Token quote, PairScale scale) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            index_.assign(keyOf(base, quote), static_cast<uint32_t>(scale.priceDecimals) << 8 | scale.sizeDecimals);
+        }
+
+        std::optional<PairScale> find(Token base, Token quote) const {
+            uint32_t packed = index_.find(keyOf(base, quote));
+            if (packed == KeyIndex<SLOTS>::NONE) {
+                return std::nullopt;
+            }
+            return PairScale{static_cast<uint8_t>(packed >> 8), static_cast<uint8_t>(packed)};
+        }
+
+    private:
+        static constexpr size_t SLOTS = 1 << 16;
+
+        std::mutex mutex_;
+        KeyIndex<SLOTS> index_;
+
+        static uint64_t keyOf(Token base, Token quote) {
+            return static_cast<uint64_t>(base) << 16 | static_cast<uint64_t>(quote);
+        }
+};
+
+/**
+* @brief Scale for a base/quote pair, at least as fine as every venue's tick
+* and lot for it. Prices of BTC and ETH in stablecoins fit in 4 places, the
+* stablecoin cross and crypto crosses need more; pairs the universe loaded
+* go finer where a venue's tick or lot asks for it.
+*/
+inline PairScale defaultScaleOf(Token base, Token quote) {
+    auto stable = [](Token token) { return token == Token::USDC || token == Token::USDT; };
+
+    if (stable(base) && stable(quote)) {
+        return PairScale{6, 6};
+    }
+    if (stable(quote)) {
+        return PairScale{4, 8};
+    }
+    return PairScale{8, 8};
+}
+
+inline PairScale scaleOf(Token base, Token quote) {
+    if (auto loaded = PairScales::shared().find(base, quote)) {
+        return *loaded;
+    }
+    return defaultScaleOf(base, quote);
+}
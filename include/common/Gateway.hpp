@@ -1,34 +1,381 @@
 #pragma once
 
 #include "Instrument.hpp"
+#include "InstrumentRegistry.hpp"
+#include "InstrumentUniverse.hpp"
+#include "MarketSnapshot.hpp"
 #include "AsyncHttp.hpp"
+#include "DepthParser.hpp"
+#include "FixedPoint.hpp"
 #include "config.hpp"
+#include "Task.hpp"
+#include "MarketStream.hpp"
+#include "TraceClock.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 class Gateway {
     private:
+        // Declared before http so in-flight requests are torn down first
+        // indexed by instrument id, on the heap as it spans the whole registry
+        std::unique_ptr<std::atomic<const AsyncHttp::PreparedRequest*>[]> prepared =
+            std::make_unique<std::atomic<const AsyncHttp::PreparedRequest*>[]>(InstrumentRegistry::CAPACITY);
+        std::vector<std::unique_ptr<AsyncHttp::PreparedRequest>> preparedStore;
+        std::mutex preparedMutex;
+
         AsyncHttp http;
+        std::shared_ptr<LatencyRecorder> latencyRecorder = std::make_shared<LatencyRecorder>();
+        // where the venue's clock stands against ours
+        ClockOffset venueClock;
+
+        // Created by the first subscribe, published through liveStream
+        std::unique_ptr<MarketStream> stream;
+        std::atomic<MarketStream*> liveStream{nullptr};
+        std::mutex streamMutex;
 
     protected:
         AsyncHttp& getHttp() {return http;}
 
+        // Stops the stream and the http event loop, no handler or callback
+        // runs afterwards. Gateways whose handlers reach into their own
+        // members call it from their destructor, before those members go.
+        void quiesce() {
+            if (MarketStream* live = liveStream.load()) {
+                live->stop();
+            }
+            http.destroy();
+        }
+
+        // Venue feed behind subscribe, null for gateways without one
+        virtual std::unique_ptr<StreamProtocol> streamProtocol() { return nullptr; }
+
+        // Top of book from the stream while it is live, without any I/O
+        std::optional<BBO> streamedBBO(Token buyToken, Token sellToken) const {
+            const MarketStream* live = liveStream.load(std::memory_order_acquire);
+            if (!live) {
+                return std::nullopt;
+            }
+            // pairs never subscribed have no id yet
+            InstrumentId id = InstrumentRegistry::shared().find(name, buyToken, sellToken);
+            return id == InstrumentRegistry::NONE ? std::nullopt : live->latest(id);
+        }
+
+        // Fills what the stream has, true when it had every pair
+        bool streamedBBOs(std::span<const Instrument> instruments, std::vector<BBO>& bbos) const {
+            bool all = true;
+            for (size_t i = 0; i < instruments.size(); i++) {
+                if (auto bbo = streamedBBO(instruments[i].baseSymbol, instruments[i].quoteSymbol)) {
+                    bbos[i] = *bbo;
+                } else {
+                    all = false;
+                }
+            }
+            return all;
+        }
+
+        // Field names of a venue's bulk ticker answer
+        struct TickerFields {
+            // key of the entry array, empty when the answer is a bare array
+            std::string_view list;
+            std::string_view symbol;
+            std::string_view bidPrice;
+            std::string_view bidSize;
+            std::string_view askPrice;
+            std::string_view askSize;
+            // per entry ms timestamp, empty when entries carry none
+            std::string_view timestamp;
+        };
+
+        // Reads a bulk ticker answer into every bbos[i] still without a quote,
+        // entries for pairs nobody asked for are skipped unparsed. Returns how
+        // many were filled, pairs missing from the answer stay empty.
+        size_t readTickers(std::string_view body, const TickerFields& fields,
+                           std::span<const Instrument> instruments, std::vector<BBO>& bbos, uint64_t timestamp) {
+            std::vector<std::pair<std::string_view, size_t>> wanted;
+            wanted.reserve(instruments.size());
+            for (size_t i = 0; i < instruments.size(); i++) {
+                if (bbos[i].timestamp == 0) {
+                    wanted.emplace_back(symbol(instruments[i].baseSymbol, instruments[i].quoteSymbol), i);
+                }
+            }
+            std::sort(wanted.begin(), wanted.end());
+
+            size_t filled = 0;
+            DepthParser::objects(body, fields.list, [&](std::string_view entry) {
+                std::string_view symbol;
+                if (!DepthParser::string(entry, fields.symbol, symbol)) {
+                    return true;
+                }
+                auto it = std::lower_bound(wanted.begin(), wanted.end(), symbol,
+                    [](const auto& item, std::string_view key) { return item.first < key; });
+
+                for (; it != wanted.end() && it->first == symbol; ++it) {
+                    const Instrument& instrument = instruments[it->second];
+                    PairScale scale = scaleOf(instrument.baseSymbol, instrument.quoteSymbol);
+                    std::string_view bidPrice, bidSize, askPrice, askSize;
+                    BBO bbo{};
+                    bbo.timestamp = timestamp;
+
+                    if (!DepthParser::decimal(entry, fields.bidPrice, bidPrice) ||
+                        !DepthParser::decimal(entry, fields.bidSize, bidSize) ||
+                        !DepthParser::decimal(entry, fields.askPrice, askPrice) ||
+                        !DepthParser::decimal(entry, fields.askSize, askSize) ||
+                        !scale.parseLevel(bidPrice, bidSize, bbo.bid) ||
+                        !scale.parseLevel(askPrice, askSize, bbo.ask) ||
+                        (!fields.timestamp.empty() && !DepthParser::integer(entry, fields.timestamp, bbo.timestamp))) {
+                        std::cerr << "[ERROR] Unreadable ticker for " << symbol << " from " << name << std::endl;
+                        continue;
+                    }
+                    bbos[it->second] = bbo;
+                    filled++;
+                }
+                return filled < wanted.size();
+            });
+            return filled;
+        }
+
+        // One fetch(base, quote) per pair the stream does not quote, all in
+        // flight at once. Gateways pass their own getBBOAsync, qualified, so
+        // decorators layered on them by inheritance see the batch only once.
+        template<typename Fetch>
+        Task<std::vector<BBO>> fanOut(std::span<const Instrument> instruments, Fetch fetch) {
+            std::vector<BBO> bbos(instruments.size());
+            if (streamedBBOs(instruments, bbos)) {
+                co_return bbos;
+            }
+
+            std::vector<Task<BBO>> tasks;
+            std::vector<size_t> fetching;
+            for (size_t i = 0; i < instruments.size(); i++) {
+                if (bbos[i].timestamp == 0) {
+                    tasks.push_back(fetch(instruments[i].baseSymbol, instruments[i].quoteSymbol));
+                    fetching.push_back(i);
+                }
+            }
+
+            auto all = when_all(std::move(tasks));
+            std::vector<BBO> fetched = co_await all;
+            for (size_t i = 0; i < fetching.size(); i++) {
+                bbos[fetching[i]] = fetched[i];
+            }
+            co_return bbos;
+        }
+
+        // getBBOsAsync of a venue with a bulk ticker endpoint. A single pair
+        // goes through fetchOne, its own depth request is cheaper than the
+        // whole market, and streamed pairs are served from memory.
+        // fetchAll(instruments, &bbos) fills the rest; when it throws the
+        // failure is logged and the pairs it did not fill stay empty.
+        template<typename FetchOne, typename FetchAll>
+        Task<std::vector<BBO>> bulkBBOs(std::span<const Instrument> instruments, FetchOne fetchOne, FetchAll fetchAll) {
+            if (instruments.size() < 2) {
+                auto single = fanOut(instruments, fetchOne);
+                co_return co_await single;
+            }
+
+            std::vector<BBO> bbos(instruments.size());
+            if (streamedBBOs(instruments, bbos)) {
+                co_return bbos;
+            }
+
+            try {
+                auto fill = fetchAll(instruments, &bbos);
+                co_await fill;
+            } catch (const std::exception& e) {
+                std::cerr << "[ERROR] Exception fetching BBOs for " << this->name << " details: " << e.what() << std::endl;
+            }
+            co_return bbos;
+        }
+
+        // Body of a 200 answer, throws with the venue's reply otherwise
+        static std::string_view okBody(const AsyncHttp::Response& res) {
+            if (res.status_code != 200) {
+                throw std::runtime_error("HTTP " + std::to_string(res.status_code) + " " + res.body.str());
+            }
+            return res.body.view();
+        }
+
+        // Paces every request of this gateway to the venue's published limit
+        void limitRate(RateLimiter::Config config) {
+            http.set_rate_limiter(std::make_shared<RateLimiter>(std::move(config)));
+        }
+
+        // GETs the venue's instrument metadata and reads it with parse(body).
+        // Startup only: the answer runs to megabytes on the reference lane.
+        template<typename Parse>
+        std::vector<Listing> fetchListings(const std::string& listingsUrl, uint32_t weight, Parse&& parse) {
+            try {
+                AsyncHttp::RequestOptions options;
+                options.lane = HttpLane::REFERENCE;
+                options.queue_timeout = std::chrono::seconds(10);
+                options.timeout = std::chrono::seconds(10);
+                options.weight = weight;
+
+                auto res = http.get_raw(listingsUrl, {{"Accept", "application/json"}}, options).get();
+                if (res.status_code != 200) {
+                    std::cerr << "[ERROR] Exception fetching listings for " << this->name << " details: " << res.body << std::endl;
+                    return {};
+                }
+                return parse(std::string_view(res.body));
+
+            } catch (const std::exception& e) {
+                std::cerr << "[ERROR] Exception fetching listings for " << this->name << " details: " << e.what() << std::endl;
+                return {};
+            }
+        }
+
+        // Runs parse() and files its time as the PARSE phase of the response's endpoint
+        template<typename Parse>
+        static auto timedParse(const AsyncHttp::Response& res, Parse&& parse) {
+            auto start = std::chrono::steady_clock::now();
+            auto parsed = parse();
+            if (res.latency) {
+                res.latency->record(EndpointLatency::Phase::PARSE,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            }
+            return parsed;
+        }
+
+        // Trace stamps of a quote read from res: arrival, parse done now and,
+        // when venueTime says the timestamp is the venue's, that on our clock
+        void stampQuote(BBO& bbo, const AsyncHttp::Response& res, bool venueTime) {
+            bbo.receivedAt = res.received_at;
+            bbo.parsedAt = traceNow();
+            bbo.exchangeAt = venueTime ? venueClock.toLocal(bbo.timestamp, res.received_at) : 0;
+        }
+
+        // The same for every quote a bulk answer filled, streamed ones keep their own
+        void stampQuotes(std::vector<BBO>& bbos, const AsyncHttp::Response& res, bool venueTime) {
+            for (BBO& bbo : bbos) {
+                if (bbo.timestamp != 0 && bbo.receivedAt == 0) {
+                    stampQuote(bbo, res, venueTime);
+                }
+            }
+        }
+
+        // Options for a pair's depth request. Depth is an idempotent GET, so a
+        // duplicate is raced when the venue lags, and concurrent callers share
+        // one fetch.
+        static AsyncHttp::RequestOptions depthOptions() {
+            AsyncHttp::RequestOptions options;
+            options.hedge = true;
+            options.coalesce = true;
+            return options;
+        }
+
+        // Request for a pair, built by make() on first use and reused afterwards
+        template<typename Make>
+        const AsyncHttp::PreparedRequest& preparedFor(Token buyToken, Token sellToken, Make&& make) {
+            auto& slot = prepared[instrumentId(buyToken, sellToken)];
+            if (const auto* request = slot.load(std::memory_order_acquire)) {
+                return *request;
+            }
+
+            std::lock_guard<std::mutex> lock(preparedMutex);
+            if (const auto* request = slot.load(std::memory_order_acquire)) {
+                return *request;
+            }
+
+            preparedStore.push_back(std::make_unique<AsyncHttp::PreparedRequest>(make()));
+            slot.store(preparedStore.back().get(), std::memory_order_release);
+            return *preparedStore.back();
+        }
+
 
     public:
         std::string url;
+        // WebSocket endpoint for market data, empty to stay on REST
+        std::string streamUrl;
         Exchange name;
 
         virtual BBO getBBO(Token buyToken, Token sellToken) = 0;
+
+        // Non blocking flavour, resumes on the gateway's http event loop.
+        // Falls back to the blocking call for gateways without one.
+        virtual Task<BBO> getBBOAsync(Token buyToken, Token sellToken) {
+            co_return getBBO(buyToken, sellToken);
+        }
         virtual std::string getTicker(Token& base, Token& quote) = 0;
 
+        // Registry id of the pair's spot instrument on this venue, its ticker
+        // comes from getTicker once, when the pair is first seen
+        InstrumentId instrumentId(Token base, Token quote) {
+            return InstrumentRegistry::shared().intern(Instrument(base, quote, name, FeedType::SPOT),
+                [&]() { return getTicker(base, quote); });
+        }
+
+        // The venue's symbol for the pair, built once
+        const std::string& symbol(Token base, Token quote) {
+            return InstrumentRegistry::shared().ticker(instrumentId(base, quote));
+        }
+
+        // Top of book for many pairs, in the order asked. Venues with a bulk
+        // ticker endpoint override this with one request and one parse, the
+        // default fans out a getBBOAsync per pair. Failed pairs come back empty.
+        virtual Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) {
+            return fanOut(instruments, [this](Token base, Token quote) { return getBBOAsync(base, quote); });
+        }
+
+        std::vector<BBO> getBBOs(std::span<const Instrument> instruments) {
+            return sync_wait(getBBOsAsync(instruments));
+        }
+
+        // Streams the pair's top of book, getBBO serves it from memory from
+        // then on and falls back to REST whenever the stream is down
+        virtual void subscribe(Token buyToken, Token sellToken) {
+            std::lock_guard<std::mutex> lock(streamMutex);
+            if (!stream) {
+                auto protocol = streamProtocol();
+                if (streamUrl.empty() || !protocol) {
+                    return;
+                }
+                stream = std::make_unique<MarketStream>(streamUrl, std::move(protocol), &venueClock);
+                liveStream.store(stream.get(), std::memory_order_release);
+            }
+            InstrumentId id = instrumentId(buyToken, sellToken);
+            stream->subscribe(InstrumentRegistry::shared().ticker(id), id, scaleOf(buyToken, sellToken));
+        }
+
+        // Every spot instrument the venue lists with its tick, lot and status,
+        // empty for venues without a metadata endpoint or when the fetch failed
+        virtual std::vector<Listing> listings() { return {}; }
+
+        // Opens every pooled connection to the venue ahead of the first scan,
+        // returns how many came up
+        virtual size_t prewarm() {
+            return http.prewarm(url);
+        }
+
+        // Where this gateway's requests spend their time, by endpoint and phase
+        virtual LatencyRecorder& latency() { return *latencyRecorder; }
+
+        // Request counts, queue depth and pool occupancy, lock free
+        virtual AsyncHttp::LoadStats httpLoad() const { return http.load_stats(); }
+
+        // Estimated lead of the venue's clock over ours in ns, 0 until the
+        // venue sent a timestamp of its own
+        virtual int64_t clockLead() const { return venueClock.lead(); }
+
         Gateway() {
             http.init(5);
+            http.set_latency_recorder(latencyRecorder);
         }
 
         void destroy() {
             std::cout << "Destroying " << name << " Gateway\n";
-            http.destroy();
+            quiesce();
         }
 
         virtual ~Gateway() = default;
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class HttpBufferPool;
+
+/**
+* @brief Storage behind one response: body bytes plus optional flat headers.
+* Slots are reference counted and go back to their pool once the last
+* HttpBody/HttpHeaders handle lets go, keeping their reserved capacity.
+*/
+struct HttpBufferSlot {
+    // name and value offsets into header_data
+    struct Field {
+        uint32_t name_pos;
+        uint32_t name_len;
+        uint32_t value_pos;
+        uint32_t value_len;
+    };
+
+    std::string body;
+    std::string header_data;
+    std::vector<Field> header_fields;
+
+    std::atomic<uint32_t> refs{0};
+    // keeps the pool alive while the slot is leased, null for unpooled slots
+    std::shared_ptr<HttpBufferPool> owner;
+
+    void clear() {
+        body.clear();
+        header_data.clear();
+        header_fields.clear();
+    }
+};
+
+class HttpBufferPool : public std::enable_shared_from_this<HttpBufferPool> {
+    public:
+        HttpBufferPool(size_t body_reserve = 16384, size_t header_reserve = 1024)
+            : body_reserve_(body_reserve), header_reserve_(header_reserve) {}
+
+        ~HttpBufferPool() {
+            for (auto* slot : free_) {
+                delete slot;
+            }
+        }
+
+        HttpBufferPool(const HttpBufferPool&) = delete;
+        HttpBufferPool& operator=(const HttpBufferPool&) = delete;
+
+        // Pre-allocates slots so the steady state never reaches the allocator
+        void reserve(size_t count) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (free_.size() < count) {
+                free_.push_back(make_slot());
+            }
+        }
+
+        HttpBufferSlot* lease() {
+            HttpBufferSlot* slot = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!free_.empty()) {
+                    slot = free_.back();
+                    free_.pop_back();
+                }
+            }
+
+            if (!slot) {
+                slot = make_slot();
+            }
+
+            slot->owner = shared_from_this();
+            slot->refs.store(1, std::memory_order_relaxed);
+            return slot;
+        }
+
+        void release(HttpBufferSlot* slot) {
+            slot->clear();
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(slot);
+        }
+
+        size_t available() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return free_.size();
+        }
+
+    private:
+        size_t body_reserve_;
+        size_t header_reserve_;
+        std::vector<HttpBufferSlot*> free_;
+        mutable std::mutex mutex_;
+
+        HttpBufferSlot* make_slot() {
+            auto* slot = new HttpBufferSlot();
+            slot->body.reserve(body_reserve_);
+            slot->header_data.reserve(header_reserve_);
+            slot->header_fields.reserve(32);
+            return slot;
+        }
+};
+
+// Shared handle on a slot, copying only bumps the reference count
+class HttpBufferRef {
+    public:
+        HttpBufferRef() = default;
+
+        // Takes over the reference handed out by HttpBufferPool::lease
+        explicit HttpBufferRef(HttpBufferSlot* slot) : slot_(slot) {}
+
+        HttpBufferRef(const HttpBufferRef& other) : slot_(other.slot_) {
+            if (slot_) {
+                slot_->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        HttpBufferRef(HttpBufferRef&& other) noexcept : slot_(other.slot_) {
+            other.slot_ = nullptr;
+        }
+
+        HttpBufferRef& operator=(HttpBufferRef other) noexcept {
+            std::swap(slot_, other.slot_);
+            return *this;
+        }
+
+        ~HttpBufferRef() { reset(); }
+
+        void reset() {
+            if (!slot_) {
+                return;
+            }
+
+            if (slot_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                // owner may be the last thing keeping the pool alive
+                std::shared_ptr<HttpBufferPool> owner = std::move(slot_->owner);
+                if (owner) {
+                    owner->release(slot_);
+                } else {
+                    delete slot_;
+                }
+            }
+            slot_ = nullptr;
+        }
+
+        HttpBufferSlot* get() const { return slot_; }
+        explicit operator bool() const { return slot_ != nullptr; }
+
+        // Slot outside any pool, for error text and other cold paths
+        static HttpBufferRef unpooled() {
+            auto* slot = new HttpBufferSlot();
+            slot->refs.store(1, std::memory_order_relaxed);
+            return HttpBufferRef(slot);
+        }
+
+    private:
+        HttpBufferSlot* slot_ = nullptr;
+};
+
+/**
+* @brief Response body backed by a pooled buffer. Reads like a string view.
+*/
+class HttpBody {
+    public:
+        HttpBody() = default;
+        explicit HttpBody(HttpBufferRef buffer) : buffer_(std::move(buffer)) {}
+
+        HttpBody& operator=(std::string_view text) {
+            buffer_ = HttpBufferRef::unpooled();
+            buffer_.get()->body.assign(text);
+            return *this;
+        }
+
+        std::string_view view() const {
+            return buffer_ ? std::string_view(buffer_.get()->body) : std::string_view();
+        }
+
+        operator std::string_view() const { return view(); }
+        std::string str() const { return std::string(view()); }
+
+        const char* data() const { return view().data(); }
+        size_t size() const { return view().size(); }
+        bool empty() const { return view().empty(); }
+
+        const char* begin() const { return data(); }
+        const char* end() const { return data() + size(); }
+
+        friend std::ostream& operator<<(std::ostream& os, const HttpBody& body) {
+            return os << body.view();
+        }
+
+    private:
+        HttpBufferRef buffer_;
+};
+
+/**
+* @brief Flat response headers, only filled when the request asked for them.
+* Lookups are case-insensitive linear scans, responses carry a handful of lines.
+*/
+class HttpHeaders {
+    public:
+        HttpHeaders() = default;
+        explicit HttpHeaders(HttpBufferRef buffer) : buffer_(std::move(buffer)) {}
+
+        size_t size() const {
+            return buffer_ ? buffer_.get()->header_fields.size() : 0;
+        }
+
+        bool empty() const { return size() == 0; }
+
+        std::string_view name(size_t i) const {
+            const auto& field = buffer_.get()->header_fields[i];
+            return std::string_view(buffer_.get()->header_data).substr(field.name_pos, field.name_len);
+        }
+
+        std::string_view value(size_t i) const {
+            const auto& field = buffer_.get()->header_fields[i];
+            return std::string_view(buffer_.get()->header_data).substr(field.value_pos, field.value_len);
+        }
+
+        // Empty view when the header is missing
+        std::string_view find(std::string_view key) const {
+            for (size_t i = 0; i < size(); i++) {
+                std::string_view candidate = name(i);
+                if (candidate.size() == key.size() &&
+                    std::equal(candidate.begin(), candidate.end(), key.begin(),
+                        [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) ==
+                                                    std::tolower(static_cast<unsigned char>(b)); })) {
+                    return value(i);
+                }
+            }
+            return {};
+        }
+
+    private:
+        HttpBufferRef buffer_;
+};
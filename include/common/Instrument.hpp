@@ -1,6 +1,13 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <unordered_map>
 #include <stdexcept>
@@ -16,13 +23,84 @@ enum class Exchange {
     OKX,
 };
 
-enum class Token {
+constexpr size_t EXCHANGE_COUNT = static_cast<size_t>(Exchange::OKX) + 1;
+
+// Assets are open ended: the named ones are always there, every other
+// symbol gets the next value from TokenTable when the instrument universe
+// is loaded.
+enum class Token : uint16_t {
     BTC,
     ETH,
     USDC,
     USDT
 };
 
+constexpr size_t MAX_TOKENS = 1 << 13;
+
+/**
+* @brief Symbol of every Token value handed out so far. Values are dense and
+* never reused, so a token fits wherever a uint16_t does. Interning takes a
+* lock, reading a name back does not.
+*/
+class TokenTable {
+    public:
+        static TokenTable& shared() {
+            static TokenTable table;
+            return table;
+        }
+
+        TokenTable(const TokenTable&) = delete;
+        TokenTable& operator=(const TokenTable&) = delete;
+
+        // The symbol's token, the next free value when it is new
+        Token intern(std::string_view symbol) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = bySymbol_.find(symbol);
+            if (it != bySymbol_.end()) {
+                return it->second;
+            }
+            if (store_.size() == MAX_TOKENS) {
+                throw std::length_error("Token table full at " + std::string(symbol));
+            }
+
+            Token token = static_cast<Token>(store_.size());
+            store_.push_back(std::make_unique<std::string>(symbol));
+            bySymbol_.emplace(*store_.back(), token);
+            names_[static_cast<size_t>(token)].store(store_.back().get(), std::memory_order_release);
+            return token;
+        }
+
+        std::optional<Token> find(std::string_view symbol) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = bySymbol_.find(symbol);
+            return it == bySymbol_.end() ? std::nullopt : std::optional<Token>(it->second);
+        }
+
+        // Null for values never handed out
+        const std::string* name(Token token) const {
+            size_t slot = static_cast<size_t>(token);
+            return slot < MAX_TOKENS ? names_[slot].load(std::memory_order_acquire) : nullptr;
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return store_.size();
+        }
+
+    private:
+        std::array<std::atomic<const std::string*>, MAX_TOKENS> names_{};
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<std::string>> store_;
+        // keys view into store_
+        std::unordered_map<std::string_view, Token> bySymbol_;
+
+        TokenTable() {
+            for (const char* symbol : {"BTC", "ETH", "USDC", "USDT"}) {
+                intern(symbol);
+            }
+        }
+};
+
 enum class FeedType {
     SWAP,
     OPTIONS,
@@ -31,6 +109,8 @@ enum class FeedType {
     UNKNOWN
 };
 
+constexpr size_t FEED_TYPE_COUNT = static_cast<size_t>(FeedType::UNKNOWN) + 1;
+
 enum class FutureExpiration {
     NOT_A_FUTURE,
     WEEKLY,
@@ -42,8 +122,8 @@ enum class FutureExpiration {
 
 template<>
 struct EnumTraits<Exchange> {
-    static Exchange fromString(const std::string& str) {
-        static const std::unordered_map<std::string, Exchange> mapping = {
+    static Exchange fromString(std::string_view str) {
+        static const std::unordered_map<std::string_view, Exchange> mapping = {
             {"BINANCE", Exchange::BINANCE},
             {"BYBIT", Exchange::BYBIT},
             {"DYDX", Exchange::DYDX},
@@ -55,7 +135,7 @@ struct EnumTraits<Exchange> {
         if (it != mapping.end()) {
             return it->second;
         }
-        throw std::invalid_argument("Invalid exchange string: " + str);
+        throw std::invalid_argument("Invalid exchange string: " + std::string(str));
     }
 
     static std::string toString(const Exchange value) {
@@ -72,36 +152,23 @@ struct EnumTraits<Exchange> {
 
 template<>
 struct EnumTraits<Token> {
-    static Token fromString(const std::string& str) {
-        static const std::unordered_map<std::string, Token> mapping = {
-            {"BTC", Token::BTC},
-            {"ETH", Token::ETH},
-            {"USDC", Token::USDC},
-            {"USDT", Token::USDT},
-        };
-
-        auto it = mapping.find(str);
-        if (it != mapping.end()) {
-            return it->second;
+    static Token fromString(std::string_view str) {
+        if (auto token = TokenTable::shared().find(str)) {
+            return *token;
         }
-        throw std::invalid_argument("Invalid token string: " + str);
+        throw std::invalid_argument("Invalid token string: " + std::string(str));
     }
 
     static std::string toString(const Token value) {
-        switch (value) {
-            case Token::BTC: return "BTC";
-            case Token::ETH: return "ETH";
-            case Token::USDC: return "USDC";
-            case Token::USDT: return "USDT";
-            default: return "UNKNOWN";
-        }
+        const std::string* name = TokenTable::shared().name(value);
+        return name ? *name : "UNKNOWN";
     }
 };
 
 template<>
 struct EnumTraits<FeedType> {
-    static FeedType fromString(const std::string& str) {
-        static const std::unordered_map<std::string, FeedType> mapping = {
+    static FeedType fromString(std::string_view str) {
+        static const std::unordered_map<std::string_view, FeedType> mapping = {
             {"SWAP", FeedType::SWAP},
             {"OPTIONS", FeedType::OPTIONS},
             {"FUTURES", FeedType::FUTURES},
@@ -113,7 +180,7 @@ struct EnumTraits<FeedType> {
         if (it != mapping.end()) {
             return it->second;
         }
-        throw std::invalid_argument("Invalid feed type string: " + str);
+        throw std::invalid_argument("Invalid feed type string: " + std::string(str));
     }
 
     static std::string toString(const FeedType value) {
@@ -130,8 +197,8 @@ struct EnumTraits<FeedType> {
 
 template<>
 struct EnumTraits<FutureExpiration> {
-    static FutureExpiration fromString(const std::string& str) {
-        static const std::unordered_map<std::string, FutureExpiration> mapping = {
+    static FutureExpiration fromString(std::string_view str) {
+        static const std::unordered_map<std::string_view, FutureExpiration> mapping = {
             {"NOT_A_FUTURE", FutureExpiration::NOT_A_FUTURE},
             {"WEEKLY", FutureExpiration::WEEKLY},
             {"BIWEEKLY", FutureExpiration::BIWEEKLY},
@@ -144,7 +211,7 @@ struct EnumTraits<FutureExpiration> {
         if (it != mapping.end()) {
             return it->second;
         }
-        throw std::invalid_argument("Invalid future expiration string: " + str);
+        throw std::invalid_argument("Invalid future expiration string: " + std::string(str));
     }
 
     static std::string toString(const FutureExpiration value) {
@@ -208,34 +275,31 @@ public:
         feedType(ft),
         futureExpiration(fe) {}
 
-    static Instrument fromString(const std::string& str) {
-        std::vector<std::string> parts;
-
+    // Parses "EXCHANGE:BASE/QUOTE:TYPE" in place, TYPE is a feed type or a
+    // future expiration
+    static Instrument fromString(std::string_view str) {
         size_t firstColon = str.find(':');
-        if (firstColon == std::string::npos) {
+        if (firstColon == std::string_view::npos) {
             throw std::invalid_argument("Invalid instrument string: missing first colon");
         }
 
-        std::string exchangeStr = str.substr(0, firstColon);
-        Exchange ex = EnumTraits<Exchange>::fromString(exchangeStr);
+        Exchange ex = EnumTraits<Exchange>::fromString(str.substr(0, firstColon));
 
         size_t slash = str.find('/', firstColon + 1);
-        if (slash == std::string::npos) {
+        if (slash == std::string_view::npos) {
             throw std::invalid_argument("Invalid instrument string: missing slash");
         }
 
-        std::string baseStr = str.substr(firstColon + 1, slash - firstColon - 1);
-        Token base = EnumTraits<Token>::fromString(baseStr);
+        Token base = EnumTraits<Token>::fromString(str.substr(firstColon + 1, slash - firstColon - 1));
 
         size_t secondColon = str.find(':', slash + 1);
-        if (secondColon == std::string::npos) {
+        if (secondColon == std::string_view::npos) {
             throw std::invalid_argument("Invalid instrument string: missing second colon");
         }
 
-        std::string quoteStr = str.substr(slash + 1, secondColon - slash - 1);
-        Token quote = EnumTraits<Token>::fromString(quoteStr);
+        Token quote = EnumTraits<Token>::fromString(str.substr(slash + 1, secondColon - slash - 1));
 
-        std::string typeStr = str.substr(secondColon + 1);
+        std::string_view typeStr = str.substr(secondColon + 1);
 
         try {
             FeedType ft = EnumTraits<FeedType>::fromString(typeStr);
@@ -245,7 +309,7 @@ public:
                 FutureExpiration fe = EnumTraits<FutureExpiration>::fromString(typeStr);
                 return Instrument(base, quote, ex, FeedType::FUTURES, fe);
             } catch (const std::invalid_argument&) {
-                throw std::invalid_argument("Invalid feed type or future expiration: " + typeStr);
+                throw std::invalid_argument("Invalid feed type or future expiration: " + std::string(typeStr));
             }
         }
     }
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Instrument.hpp"
+#include "KeyIndex.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using InstrumentId = uint32_t;
+
+/**
+* @brief Numbers every (exchange, base, quote, feed type) the process
+* touches 0, 1, 2... on first use, so hot paths keep per instrument state
+* in flat arrays indexed by id instead of hashing strings. Each entry keeps
+* its canonical name and the venue's own ticker, both built once.
+*
+* Ids are handed out under a lock, looking one up is a short lock free probe
+* and reading an entry a single acquire load. Entries are never removed or
+* moved.
+*/
+class InstrumentRegistry {
+    public:
+        static constexpr InstrumentId NONE = ~InstrumentId(0);
+        // every venue's full spot listing with room to spare
+        static constexpr size_t CAPACITY = 1 << 15;
+
+        struct Entry {
+            InstrumentId id;
+            Instrument instrument;
+            // "BINANCE:BTC/USDC:SPOT"
+            std::string name;
+            // the venue's symbol, "BTCUSDC" or "BTC-USDC"
+            std::string ticker;
+        };
+
+        InstrumentRegistry() = default;
+
+        InstrumentRegistry(const InstrumentRegistry&) = delete;
+        InstrumentRegistry& operator=(const InstrumentRegistry&) = delete;
+
+        static InstrumentRegistry& shared() {
+            static InstrumentRegistry registry;
+            return registry;
+        }
+
+        // Id of the instrument, registered with ticker() as the venue's
+        // symbol when it is new; ticker() is not called otherwise
+        template<typename Ticker>
+        InstrumentId intern(const Instrument& instrument, Ticker&& ticker) {
+            const uint64_t key = keyOf(instrument.exchange, instrument.baseSymbol,
+                                       instrument.quoteSymbol, instrument.feedType);
+            InstrumentId id = byKey_.find(key);
+            if (id != NONE) {
+                return id;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = byKey_.find(key);
+            if (id != NONE) {
+                return id;
+            }
+            if (store_.size() == CAPACITY) {
+                throw std::length_error("Instrument registry full at " + instrument.toString());
+            }
+
+            id = static_cast<InstrumentId>(store_.size());
+            store_.push_back(std::make_unique<Entry>(Entry{id, instrument, instrument.toString(), ticker()}));
+            const Entry* entry = store_.back().get();
+            byName_.emplace(entry->name, id);
+
+            entries_[id].store(entry, std::memory_order_release);
+            byKey_.assign(key, id);
+            return id;
+        }
+
+        // NONE until the instrument was interned
+        InstrumentId find(Exchange exchange, Token base, Token quote, FeedType feedType = FeedType::SPOT) const {
+            return byKey_.find(keyOf(exchange, base, quote, feedType));
+        }
+
+        // By canonical name, "OKX:ETH/USDT:SPOT", without building a string
+        InstrumentId find(std::string_view name) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = byName_.find(name);
+            return it == byName_.end() ? NONE : it->second;
+        }
+
+        const Entry& entry(InstrumentId id) const {
+            return *entries_[id].load(std::memory_order_acquire);
+        }
+
+        const Instrument& instrument(InstrumentId id) const { return entry(id).instrument; }
+        const std::string& ticker(InstrumentId id) const { return entry(id).ticker; }
+        const std::string& name(InstrumentId id) const { return entry(id).name; }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return store_.size();
+        }
+
+    private:
+        std::array<std::atomic<const Entry*>, CAPACITY> entries_{};
+
+        // written under mutex_ only
+        mutable std::mutex mutex_;
+        KeyIndex<2 * CAPACITY> byKey_;
+        std::vector<std::unique_ptr<Entry>> store_;
+        // keys view into the entries' names
+        std::unordered_map<std::string_view, InstrumentId> byName_;
+
+        static uint64_t keyOf(Exchange exchange, Token base, Token quote, FeedType feedType) {
+            return static_cast<uint64_t>(exchange) << 40 | static_cast<uint64_t>(base) << 24 |
+                   static_cast<uint64_t>(quote) << 8 | static_cast<uint64_t>(feedType);
+        }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "FixedPoint.hpp"
+#include "Instrument.hpp"
+#include "InstrumentRegistry.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class ListingStatus {
+    TRADING,
+    // suspended, delisting or not open yet, anything that cannot be traded now
+    HALTED
+};
+
+// One spot instrument as its venue's metadata endpoint describes it
+struct Listing {
+    Exchange exchange;
+    Token base;
+    Token quote;
+    // the venue's symbol, "BTCUSDC" or "BTC-USDC"
+    std::string ticker;
+    // price and size steps as the venue sends them, "0.01000000"
+    std::string tickSize;
+    std::string lotSize;
+    ListingStatus status;
+
+    bool trading() const { return status == ListingStatus::TRADING; }
+
+    // decimals of the tick and the lot
+    PairScale scale() const {
+        return PairScale{PairScale::decimalsOf(tickSize), PairScale::decimalsOf(lotSize)};
+    }
+};
+
+/**
+* @brief Every venue's spot listings, loaded at startup from the venues'
+* metadata endpoints or a cached file. Finds the pairs trading on enough
+* venues to be scanned and registers their tickers and scales, after which
+* scans only touch the registry and PairScales, both lock free to read.
+*
+* Token values follow the order symbols were first seen, so the cache keeps
+* the token table as well and loading it first gives the same values again.
+*/
+class InstrumentUniverse {
+    public:
+        void add(std::vector<Listing> listings) {
+            listings_.insert(listings_.end(), std::make_move_iterator(listings.begin()),
+                std::make_move_iterator(listings.end()));
+        }
+
+        const std::vector<Listing>& listings() const { return listings_; }
+        size_t size() const { return listings_.size(); }
+        bool empty() const { return listings_.empty(); }
+
+        // Pairs trading on at least minVenues of venues, in the order they were
+        // first listed. The instrument's exchange is the first venue listing it.
+        std::vector<Instrument> scannable(std::span<const Exchange> venues, size_t minVenues = 2) const {
+            uint32_t wanted = 0;
+            for (Exchange venue : venues) {
+                wanted |= bit(venue);
+            }
+
+            // venues per pair, one pass over the listings
+            std::unordered_map<uint32_t, uint32_t> venuesOf;
+            std::vector<const Listing*> order;
+            for (const Listing& listing : listings_) {
+                if (!listing.trading() || !(wanted & bit(listing.exchange))) {
+                    continue;
+                }
+                uint32_t& mask = venuesOf[pairKey(listing.base, listing.quote)];
+                if (mask == 0) {
+                    order.push_back(&listing);
+                }
+                mask |= bit(listing.exchange);
+            }
+
+            std::vector<Instrument> pairs;
+            for (const Listing* first : order) {
+                if (static_cast<size_t>(std::popcount(venuesOf[pairKey(first->base, first->quote)])) >= minVenues) {
+                    pairs.emplace_back(first->base, first->quote, first->exchange, FeedType::SPOT);
+                }
+            }
+            return pairs;
+        }
+
+        // Registers the venue tickers of every trading listing of pairs, and
+        // each pair's scale as the finest tick and lot any venue has for it,
+        // never coarser than the built in scale. Call before the first scan.
+        void apply(std::span<const Instrument> pairs,
+                   InstrumentRegistry& registry = InstrumentRegistry::shared(),
+                   PairScales& scales = PairScales::shared()) const {
+            std::unordered_map<uint32_t, PairScale> finest;
+            for (const Instrument& pair : pairs) {
+                finest.emplace(pairKey(pair.baseSymbol, pair.quoteSymbol), defaultScaleOf(pair.baseSymbol, pair.quoteSymbol));
+            }
+
+            for (const Listing& listing : listings_) {
+                auto it = finest.find(pairKey(listing.base, listing.quote));
+                if (it == finest.end() || !listing.trading()) {
+                    continue;
+                }
+                registry.intern(Instrument(listing.base, listing.quote, listing.exchange, FeedType::SPOT),
+                    [&listing]() { return listing.ticker; });
+
+                PairScale venue = listing.scale();
+                it->second.priceDecimals = std::max(it->second.priceDecimals, venue.priceDecimals);
+                it->second.sizeDecimals = std::max(it->second.sizeDecimals, venue.sizeDecimals);
+            }
+
+            for (const Instrument& pair : pairs) {
+                scales.set(pair.baseSymbol, pair.quoteSymbol, finest[pairKey(pair.baseSymbol, pair.quoteSymbol)]);
+            }
+        }
+
+        // The pairs of scannable named in spec, "BTC/USDC,ETH/USDT", or all of
+        // them for "*". Names that are not scannable are reported and skipped.
+        static std::vector<Instrument> select(std::span<const Instrument> scannable, std::string_view spec) {
+            if (spec == "*") {
+                return std::vector<Instrument>(scannable.begin(), scannable.end());
+            }
+
+            std::vector<Instrument> picked;
+            while (!spec.empty()) {
+                size_t comma = spec.find(',');
+                std::string_view name = spec.substr(0, comma);
+                spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+
+                size_t slash = name.find('/');
+                auto base = TokenTable::shared().find(name.substr(0, slash));
+                auto quote = slash == std::string_view::npos ? std::nullopt : TokenTable::shared().find(name.substr(slash + 1));
+                auto it = std::find_if(scannable.begin(), scannable.end(), [&](const Instrument& pair) {
+                    return base && quote && pair.baseSymbol == *base && pair.quoteSymbol == *quote;
+                });
+                if (it == scannable.end()) {
+                    std::cerr << "[ERROR] " << name << " is not listed on two venues, not scanning it" << std::endl;
+                    continue;
+                }
+                picked.push_back(*it);
+            }
+            return picked;
+        }
+
+        bool save(const std::string& path) const {
+            std::ofstream out(path, std::ios::trunc);
+            if (!out) {
+                std::cerr << "[ERROR] Cannot write instrument cache " << path << std::endl;
+                return false;
+            }
+            out << toJson().dump() << "\n";
+            return static_cast<bool>(out);
+        }
+
+        // Adds the cached listings, false when the file is missing or unreadable
+        bool load(const std::string& path) {
+            std::ifstream in(path);
+            if (!in) {
+                return false;
+            }
+            try {
+                fromJson(nlohmann::json::parse(in));
+                return true;
+            } catch (const std::exception& e) {
+                std::cerr << "[ERROR] Unreadable instrument cache " << path << ": " << e.what() << std::endl;
+                return false;
+            }
+        }
+
+        nlohmann::json toJson() const {
+            nlohmann::json tokens = nlohmann::json::array();
+            const TokenTable& table = TokenTable::shared();
+            for (size_t t = 0, count = table.size(); t < count; t++) {
+                tokens.push_back(*table.name(static_cast<Token>(t)));
+            }
+
+            nlohmann::json listings = nlohmann::json::array();
+            for (const Listing& listing : listings_) {
+                listings.push_back({
+                    {"exchange", EnumTraits<Exchange>::toString(listing.exchange)},
+                    {"base", EnumTraits<Token>::toString(listing.base)},
+                    {"quote", EnumTraits<Token>::toString(listing.quote)},
+                    {"ticker", listing.ticker},
+                    {"tickSize", listing.tickSize},
+                    {"lotSize", listing.lotSize},
+                    {"trading", listing.trading()}
+                });
+            }
+            return {{"tokens", tokens}, {"listings", listings}};
+        }
+
+        void fromJson(const nlohmann::json& cache) {
+            TokenTable& table = TokenTable::shared();
+            for (const auto& symbol : cache.at("tokens")) {
+                table.intern(symbol.get<std::string>());
+            }
+
+            std::vector<Listing> listings;
+            listings.reserve(cache.at("listings").size());
+            for (const auto& entry : cache.at("listings")) {
+                listings.push_back(Listing{
+                    EnumTraits<Exchange>::fromString(entry.at("exchange").get<std::string>()),
+                    table.intern(entry.at("base").get<std::string>()),
+                    table.intern(entry.at("quote").get<std::string>()),
+                    entry.at("ticker").get<std::string>(),
+                    entry.at("tickSize").get<std::string>(),
+                    entry.at("lotSize").get<std::string>(),
+                    entry.at("trading").get<bool>() ? ListingStatus::TRADING : ListingStatus::HALTED
+                });
+            }
+            add(std::move(listings));
+        }
+
+    private:
+        std::vector<Listing> listings_;
+
+        static uint32_t bit(Exchange venue) { return 1u << static_cast<uint32_t>(venue); }
+
+        static uint32_t pairKey(Token base, Token quote) {
+            return static_cast<uint32_t>(base) << 16 | static_cast<uint32_t>(quote);
+        }
+};
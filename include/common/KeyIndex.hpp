@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* @brief Fixed open addressed table from 64 bit keys to 32 bit values.
+* Writers serialize on their owner's lock, readers take none: a slot's value
+* is published before its key, so a reader that sees the key sees the value.
+* Keys are never removed. Keep it at most half full, SLOTS a power of two.
+*/
+template<size_t SLOTS>
+class KeyIndex {
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+
+    public:
+        static constexpr uint32_t NONE = ~uint32_t(0);
+
+        // NONE when the key was never assigned
+        uint32_t find(uint64_t key) const {
+            for (size_t i = home(key), probes = 0; probes < SLOTS; i = (i + 1) & (SLOTS - 1), probes++) {
+                uint64_t stored = slots_[i].key.load(std::memory_order_acquire);
+                if (stored == 0) {
+                    return NONE;
+                }
+                if (stored == key + 1) {
+                    return slots_[i].value.load(std::memory_order_relaxed);
+                }
+            }
+            return NONE;
+        }
+
+        // Sets or replaces the key's value, false when the table is full.
+        // Callers hold the lock every writer of this table takes.
+        bool assign(uint64_t key, uint32_t value) {
+            for (size_t i = home(key), probes = 0; probes < SLOTS; i = (i + 1) & (SLOTS - 1), probes++) {
+                uint64_t stored = slots_[i].key.load(std::memory_order_relaxed);
+                if (stored == key + 1) {
+                    slots_[i].value.store(value, std::memory_order_relaxed);
+                    return true;
+                }
+                if (stored == 0) {
+                    slots_[i].value.store(value, std::memory_order_relaxed);
+                    slots_[i].key.store(key + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Slot {
+            // key + 1, 0 while the slot is free
+            std::atomic<uint64_t> key{0};
+            std::atomic<uint32_t> value{NONE};
+        };
+
+        std::array<Slot, SLOTS> slots_{};
+
+        static size_t home(uint64_t key) {
+            // Fibonacci hashing, top bits of the product spread adjacent keys
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (SLOTS - 1);
+        }
+};
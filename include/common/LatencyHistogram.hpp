@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+/**
+* @brief HDR style latency histogram over nanoseconds. Values below 128 get
+* a bucket each, above that every power of two is split into 64 buckets, so
+* any value is reported within 1/64 (~1.6%) of what was recorded, up to
+* 2^40 ns (about 18 minutes); larger values land in the last bucket.
+*
+* record() is two relaxed fetch_adds, bucket and running sum, and can be
+* called from any thread.
+* Readers take a Snapshot while recording goes on; the difference of two
+* snapshots is the histogram of the interval between them.
+*/
+class LatencyHistogram {
+    public:
+        static constexpr unsigned SUB_BITS = 6;
+        static constexpr unsigned MAX_BITS = 40;
+        static constexpr size_t LINEAR = size_t(1) << (SUB_BITS + 1);
+        static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BITS;
+        static constexpr size_t BUCKETS = LINEAR + (MAX_BITS - SUB_BITS - 1) * SUB_BUCKETS;
+
+        class Snapshot {
+            public:
+                Snapshot() : counts_(BUCKETS, 0) {}
+
+                uint64_t count() const { return total_; }
+                uint64_t sum() const { return sum_; }
+
+                // How many were recorded at or below nanos, give or take the
+                // bucket nanos falls in
+                uint64_t countAtOrBelow(uint64_t nanos) const {
+                    uint64_t seen = 0;
+                    for (size_t i = 0, last = bucketOf(nanos); i <= last; i++) {
+                        seen += counts_[i];
+                    }
+                    return seen;
+                }
+
+                // Highest value equivalent to the bucket holding the given
+                // percentile (0-100), 0 when nothing was recorded
+                uint64_t percentile(double p) const {
+                    if (total_ == 0) {
+                        return 0;
+                    }
+                    uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total_) + 0.5);
+                    rank = std::clamp<uint64_t>(rank, 1, total_);
+
+                    uint64_t seen = 0;
+                    for (size_t i = 0; i < BUCKETS; i++) {
+                        seen += counts_[i];
+                        if (seen >= rank) {
+                            return highestIn(i);
+                        }
+                    }
+                    return highestIn(BUCKETS - 1);
+                }
+
+                uint64_t max() const {
+                    for (size_t i = BUCKETS; i-- > 0;) {
+                        if (counts_[i]) {
+                            return highestIn(i);
+                        }
+                    }
+                    return 0;
+                }
+
+                // What was recorded after earlier was taken
+                Snapshot since(const Snapshot& earlier) const {
+                    Snapshot interval;
+                    for (size_t i = 0; i < BUCKETS; i++) {
+                        interval.counts_[i] = counts_[i] - earlier.counts_[i];
+                        interval.total_ += interval.counts_[i];
+                    }
+                    interval.sum_ = sum_ - earlier.sum_;
+                    return interval;
+                }
+
+            private:
+                friend class LatencyHistogram;
+                std::vector<uint64_t> counts_;
+                uint64_t total_ = 0;
+                uint64_t sum_ = 0;
+        };
+
+        void record(uint64_t nanos) {
+            counts_[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(nanos, std::memory_order_relaxed);
+        }
+
+        Snapshot snapshot() const {
+            Snapshot snap;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                snap.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+                snap.total_ += snap.counts_[i];
+            }
+            snap.sum_ = sum_.load(std::memory_order_relaxed);
+            return snap;
+        }
+
+        static size_t bucketOf(uint64_t value) {
+            if (value < LINEAR) {
+                return static_cast<size_t>(value);
+            }
+            unsigned msb = std::bit_width(value) - 1;
+            if (msb >= MAX_BITS) {
+                return BUCKETS - 1;
+            }
+            unsigned shift = msb - SUB_BITS;
+            return LINEAR + (shift - 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+        }
+
+        static uint64_t highestIn(size_t bucket) {
+            if (bucket < LINEAR) {
+                return bucket;
+            }
+            unsigned shift = static_cast<unsigned>((bucket - LINEAR) / SUB_BUCKETS) + 1;
+            uint64_t top = (bucket - LINEAR) % SUB_BUCKETS + SUB_BUCKETS;
+            return ((top + 1) << shift) - 1;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKETS> counts_{};
+        std::atomic<uint64_t> sum_{0};
+};
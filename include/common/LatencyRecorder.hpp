@@ -0,0 +1,217 @@
+#pragma once
+
+#include "LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+* @brief Where a request's time went, one histogram per phase. The network
+* phases come from curl's CURLINFO_*_TIME_T timers; DNS, CONNECT and TLS are
+* only recorded when the request paid for them, a reused connection skips
+* them. PARSE is recorded by the gateway reading the answer.
+*/
+class EndpointLatency {
+    public:
+        enum class Phase {
+            QUEUE,          // waiting for a connection or rate limit budget
+            DNS,
+            CONNECT,
+            TLS,
+            TTFB,           // request sent to first response byte
+            TRANSFER,       // first to last response byte
+            PARSE,
+            TOTAL,          // queue plus the whole transfer
+            COUNT
+        };
+
+        static constexpr size_t PHASES = static_cast<size_t>(Phase::COUNT);
+
+        static constexpr std::array<const char*, PHASES> NAMES = {
+            "queue", "dns", "connect", "tls", "ttfb", "transfer", "parse", "total"
+        };
+
+        explicit EndpointLatency(std::string endpoint) : endpoint_(std::move(endpoint)) {}
+
+        const std::string& endpoint() const { return endpoint_; }
+
+        void record(Phase phase, uint64_t nanos) {
+            phases_[static_cast<size_t>(phase)].record(nanos);
+        }
+
+        const LatencyHistogram& histogram(Phase phase) const {
+            return phases_[static_cast<size_t>(phase)];
+        }
+
+    private:
+        std::string endpoint_;
+        std::array<LatencyHistogram, PHASES> phases_;
+};
+
+/**
+* @brief Latency of one client's requests by endpoint (the URL path, query
+* left out and ids folded, see endpointOf). Endpoints live in a fixed open
+* addressing table filled by compare and swap, so finding or adding one
+* never takes a lock and the entries stay put for the recorder's lifetime.
+* Requests to endpoints past the table's capacity are only counted.
+*/
+class LatencyRecorder {
+    public:
+        static constexpr size_t CAPACITY = 64;
+
+        LatencyRecorder() = default;
+        LatencyRecorder(const LatencyRecorder&) = delete;
+        LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+        ~LatencyRecorder() {
+            for (auto& slot : slots_) {
+                delete slot.load(std::memory_order_relaxed);
+            }
+        }
+
+        // The endpoint's histograms, created on first use; null when the table is full
+        EndpointLatency* endpoint(std::string_view path) {
+            size_t start = std::hash<std::string_view>{}(path) % CAPACITY;
+            for (size_t probe = 0; probe < CAPACITY; probe++) {
+                auto& slot = slots_[(start + probe) % CAPACITY];
+                EndpointLatency* entry = slot.load(std::memory_order_acquire);
+
+                if (!entry) {
+                    auto fresh = std::make_unique<EndpointLatency>(std::string(path));
+                    if (slot.compare_exchange_strong(entry, fresh.get(), std::memory_order_acq_rel)) {
+                        return fresh.release();
+                    }
+                    // lost the race, entry now holds the winner
+                }
+                if (entry->endpoint() == path) {
+                    return entry;
+                }
+            }
+            untracked_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        // Requests endpoint() found no room for
+        uint64_t untracked() const { return untracked_.load(std::memory_order_relaxed); }
+
+        // Calls visit(const EndpointLatency&) for every endpoint seen so far
+        template<typename Visit>
+        void forEach(Visit&& visit) const {
+            for (const auto& slot : slots_) {
+                if (const EndpointLatency* entry = slot.load(std::memory_order_acquire)) {
+                    visit(*entry);
+                }
+            }
+        }
+
+        // Path of a URL, "https://host/api/v3/depth?symbol=X" gives "/api/v3/depth"
+        static std::string_view pathOf(std::string_view url) {
+            size_t scheme = url.find("://");
+            size_t start = url.find('/', scheme == std::string_view::npos ? 0 : scheme + 3);
+            if (start == std::string_view::npos) {
+                return "/";
+            }
+            size_t end = url.find('?', start);
+            return url.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        }
+
+        // Endpoint of a URL: its path with every segment naming an instrument
+        // or an id, one without lowercase letters, folded into {id}, so per
+        // pair URLs share one endpoint. "https://host/products/BTC-USD/book"
+        // gives "/products/{id}/book". Views into url when nothing is folded,
+        // into scratch otherwise.
+        static std::string_view endpointOf(std::string_view url, std::string& scratch) {
+            std::string_view path = pathOf(url);
+            bool folds = false;
+            forEachSegment(path, [&](std::string_view segment) { folds = folds || isId(segment); });
+            if (!folds) {
+                return path;
+            }
+
+            scratch.clear();
+            forEachSegment(path, [&](std::string_view segment) {
+                scratch += '/';
+                scratch += isId(segment) ? std::string_view("{id}") : segment;
+            });
+            return scratch;
+        }
+
+        // Count, p50, p99, p99.9 and max per endpoint and phase for what was
+        // recorded since the previous dump, in microseconds. Recording goes on
+        // meanwhile; concurrent dumps are serialised. Rows are named label
+        // followed by the endpoint.
+        void dump(std::ostream& out, std::string_view label) {
+            std::lock_guard<std::mutex> lock(dumpMutex_);
+            for (auto& slot : slots_) {
+                EndpointLatency* entry = slot.load(std::memory_order_acquire);
+                if (!entry) {
+                    continue;
+                }
+                auto& previous = lastDump_[entry];
+                previous.resize(EndpointLatency::PHASES);
+
+                for (size_t phase = 0; phase < EndpointLatency::PHASES; phase++) {
+                    auto now = entry->histogram(static_cast<EndpointLatency::Phase>(phase)).snapshot();
+                    auto interval = now.since(previous[phase]);
+                    previous[phase] = std::move(now);
+                    if (interval.count() == 0) {
+                        continue;
+                    }
+                    writeRow(out, std::string(label) + " " + entry->endpoint(), EndpointLatency::NAMES[phase], interval);
+                }
+            }
+        }
+
+        static void writeHeader(std::ostream& out) {
+            out << std::left << std::setw(44) << "venue endpoint" << std::setw(10) << "phase"
+                << std::right << std::setw(10) << "count" << std::setw(12) << "p50 us"
+                << std::setw(12) << "p99 us" << std::setw(12) << "p99.9 us" << std::setw(12) << "max us" << "\n";
+        }
+
+        static void writeRow(std::ostream& out, const std::string& name, const char* phase,
+                             const LatencyHistogram::Snapshot& interval) {
+            auto us = [](uint64_t nanos) { return static_cast<double>(nanos) / 1000.0; };
+            auto precision = out.precision();
+            out << std::left << std::setw(44) << name << std::setw(10) << phase
+                << std::right << std::setw(10) << interval.count()
+                << std::fixed << std::setprecision(1)
+                << std::setw(12) << us(interval.percentile(50)) << std::setw(12) << us(interval.percentile(99))
+                << std::setw(12) << us(interval.percentile(99.9)) << std::setw(12) << us(interval.max())
+                << std::defaultfloat << std::setprecision(precision) << "\n";
+        }
+
+    private:
+        std::array<std::atomic<EndpointLatency*>, CAPACITY> slots_{};
+        std::atomic<uint64_t> untracked_{0};
+        // only touched by dump()
+        std::mutex dumpMutex_;
+        std::unordered_map<const EndpointLatency*, std::vector<LatencyHistogram::Snapshot>> lastDump_;
+
+        // Calls visit(segment) for each segment of a path starting with '/'
+        template<typename Visit>
+        static void forEachSegment(std::string_view path, Visit&& visit) {
+            size_t start = 0;
+            while (start < path.size()) {
+                size_t slash = path.find('/', start + 1);
+                size_t end = slash == std::string_view::npos ? path.size() : slash;
+                visit(path.substr(start + 1, end - start - 1));
+                start = end;
+            }
+        }
+
+        static bool isId(std::string_view segment) {
+            return !segment.empty() && std::none_of(segment.begin(), segment.end(),
+                [](char c) { return c >= 'a' && c <= 'z'; });
+        }
+};
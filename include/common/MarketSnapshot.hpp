@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Instrument.hpp"
+#include "config.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Every venue's top of book for every pair of one scan, fetched once
+* and read only afterwards, so all pairings compare the same quotes. Each
+* quote keeps its venue timestamp; its age is measured against the moment
+* the snapshot was taken. Venues that missed the scan deadline are flagged
+* and their quotes left empty.
+*/
+class MarketSnapshot {
+    public:
+        static constexpr uint64_t MISSING = std::numeric_limits<uint64_t>::max();
+
+        // quotes[v][p] is venues[v]'s quote for instruments[p], missed[v] flags a
+        // venue that had not answered by the scan deadline
+        MarketSnapshot(std::vector<Exchange> venues, std::span<const Instrument> instruments,
+                       const std::vector<std::vector<BBO>>& quotes, uint64_t takenAt,
+                       std::vector<bool> missed = {})
+            : venues_(std::move(venues)), instruments_(instruments.begin(), instruments.end()),
+              missed_(std::move(missed)), takenAt_(takenAt) {
+            missed_.resize(venues_.size(), false);
+            quotes_.reserve(venues_.size() * instruments_.size());
+            for (const auto& venueQuotes : quotes) {
+                quotes_.insert(quotes_.end(), venueQuotes.begin(), venueQuotes.end());
+            }
+        }
+
+        size_t venues() const { return venues_.size(); }
+        size_t pairs() const { return instruments_.size(); }
+
+        Exchange venue(size_t v) const { return venues_[v]; }
+        const Instrument& instrument(size_t p) const { return instruments_[p]; }
+        const BBO& quote(size_t v, size_t p) const { return quotes_[v * instruments_.size() + p]; }
+
+        uint64_t takenAt() const { return takenAt_; }
+
+        // The venue's quotes are all empty because it was too slow
+        bool missed(size_t v) const { return missed_[v]; }
+
+        // ms from the quote's timestamp to the snapshot, MISSING when the venue
+        // gave none. Venue clocks running ahead of ours count as zero.
+        uint64_t age(size_t v, size_t p) const {
+            uint64_t timestamp = quote(v, p).timestamp;
+            if (timestamp == 0) {
+                return MISSING;
+            }
+            return timestamp >= takenAt_ ? 0 : takenAt_ - timestamp;
+        }
+
+        bool fresh(size_t v, size_t p, std::chrono::milliseconds maxAge) const {
+            return age(v, p) <= static_cast<uint64_t>(maxAge.count());
+        }
+
+        static uint64_t nowMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        std::vector<Exchange> venues_;
+        std::vector<Instrument> instruments_;
+        // venue major, one row of pairs per venue
+        std::vector<BBO> quotes_;
+        std::vector<bool> missed_;
+        uint64_t takenAt_;
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "FixedPoint.hpp"
+#include "Instrument.hpp"
+#include "InstrumentRegistry.hpp"
+#include "TraceClock.hpp"
+#include "WebSocket.hpp"
+#include "config.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Wire text of a top of book update, views into the frame it came from
+struct WireQuote {
+    std::string_view bidPrice;
+    std::string_view bidSize;
+    std::string_view askPrice;
+    std::string_view askSize;
+    // the venue's epoch ms stamp of the update, 0 when the frame has none
+    uint64_t venueMs = 0;
+};
+
+/**
+* @brief Venue specific half of a market data stream: what to send to
+* subscribe and how to read top of book out of a frame.
+*/
+class StreamProtocol {
+    public:
+        virtual ~StreamProtocol() = default;
+
+        virtual std::string subscribeMessage(const std::string& ticker) = 0;
+
+        // Points ticker and quote into the frame, false for frames carrying no
+        // quote (acks, heartbeats). Sides left empty keep their old value.
+        virtual bool parse(std::string_view frame, std::string_view& ticker, WireQuote& quote) = 0;
+
+        // Text keepalive on top of ws pings, empty when the venue needs none
+        virtual std::string heartbeat() { return ""; }
+};
+
+/**
+* @brief Latest BBO per subscribed pair, kept current by a WebSocket feed.
+* Quotes are only served while the connection is up, they are dropped on
+* disconnect and the subscriptions are replayed on every reconnect.
+*/
+class MarketStream {
+    public:
+        // venueClock places the frames' venue stamps on our clock, null to
+        // leave streamed quotes without an exchange stamp
+        MarketStream(std::string url, std::unique_ptr<StreamProtocol> protocol, ClockOffset* venueClock = nullptr)
+            : protocol_(std::move(protocol)), venueClock_(venueClock),
+              client_(std::move(url), client_options(*protocol_)) {
+            client_.start(
+                [this]() { resubscribe(); },
+                [this](std::string_view frame) { on_frame(frame); },
+                [this]() { clear(); });
+        }
+
+        ~MarketStream() { stop(); }
+
+        MarketStream(const MarketStream&) = delete;
+        MarketStream& operator=(const MarketStream&) = delete;
+
+        // Streams the instrument's quotes, id is its InstrumentRegistry id
+        void subscribe(const std::string& ticker, InstrumentId id, PairScale scale) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (tickers_.count(ticker)) {
+                    return;
+                }
+                if (slots_.size() <= id) {
+                    slots_.resize(id + 1, NO_SLOT);
+                }
+                slots_[id] = static_cast<uint32_t>(quotes_.size());
+                tickers_.emplace(ticker, Subscription{slots_[id], scale});
+                quotes_.emplace_back();
+            }
+            // Not connected yet is fine, on_open sends every subscription
+            client_.send(protocol_->subscribeMessage(ticker));
+        }
+
+        std::optional<BBO> latest(InstrumentId id) const {
+            if (!client_.connected()) {
+                return std::nullopt;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (id >= slots_.size() || slots_[id] == NO_SLOT) {
+                return std::nullopt;
+            }
+            BBO quote = quotes_[slots_[id]];
+            if (!quote.bid.price || !quote.ask.price) {
+                return std::nullopt;
+            }
+            // the venue pushes every change of the top of book, so a live
+            // subscription is current however long ago its last frame came
+            quote.timestamp = wallMs();
+            return quote;
+        }
+
+        bool connected() const { return client_.connected(); }
+        uint64_t connects() const { return client_.connects(); }
+
+        void stop() { client_.stop(); }
+
+    private:
+        static constexpr uint32_t NO_SLOT = ~uint32_t(0);
+
+        struct Subscription {
+            uint32_t slot;
+            PairScale scale;
+        };
+
+        std::unique_ptr<StreamProtocol> protocol_;
+        ClockOffset* venueClock_;
+        mutable std::mutex mutex_;
+        std::map<std::string, Subscription, std::less<>> tickers_;
+        // one quote per subscription, slots_ maps instrument ids onto them
+        std::vector<BBO> quotes_;
+        std::vector<uint32_t> slots_;
+        // last, its thread must stop before anything above goes away
+        WebSocketClient client_;
+
+        static uint64_t wallMs() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        static WebSocketClient::Options client_options(StreamProtocol& protocol) {
+            WebSocketClient::Options options;
+            options.heartbeat = protocol.heartbeat();
+            return options;
+        }
+
+        void resubscribe() {
+            std::vector<std::string> tickers;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto& entry : tickers_) {
+                    tickers.push_back(entry.first);
+                }
+            }
+            for (const auto& ticker : tickers) {
+                client_.send(protocol_->subscribeMessage(ticker));
+            }
+        }
+
+        void on_frame(std::string_view frame) {
+            const uint64_t received = traceNow();
+            std::string_view ticker;
+            WireQuote wire{};
+            try {
+                if (!protocol_->parse(frame, ticker, wire)) {
+                    return;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "[ERROR] Unreadable stream frame: " << e.what() << std::endl;
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = tickers_.find(ticker);
+            if (it == tickers_.end()) {
+                return;
+            }
+
+            const PairScale scale = it->second.scale;
+            PriceLevel bid{}, ask{};
+            if ((!wire.bidPrice.empty() && !scale.parseLevel(wire.bidPrice, wire.bidSize, bid)) ||
+                (!wire.askPrice.empty() && !scale.parseLevel(wire.askPrice, wire.askSize, ask))) {
+                std::cerr << "[ERROR] Unreadable stream frame: price finer than the pair's scale" << std::endl;
+                return;
+            }
+
+            BBO& quote = quotes_[it->second.slot];
+            if (!wire.bidPrice.empty()) {
+                quote.bid = bid;
+            }
+            if (!wire.askPrice.empty()) {
+                quote.ask = ask;
+            }
+            quote.timestamp = wallMs();
+            quote.receivedAt = received;
+            quote.parsedAt = traceNow();
+            quote.exchangeAt = venueClock_ ? venueClock_->toLocal(wire.venueMs, received) : 0;
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::fill(quotes_.begin(), quotes_.end(), BBO{});
+        }
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Arber.hpp"
+#include "Instrument.hpp"
+#include "TraceClock.hpp"
+
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+* @brief Where the time between a quote leaving the venue and the
+* opportunity reaching the observers went. Every stamp is steady_clock ns,
+* 0 when unknown: venues without their own timestamps have no exchange
+* stamp, and quotes served from a stream keep the stamps of their frame.
+*/
+struct OpportunityTrace {
+    enum Stage {
+        EXCHANGE,       // venue's own stamp of the quote
+        RECEIVED,       // answer or frame off the socket
+        PARSED,
+        STAGE_COUNT
+    };
+
+    Token base;
+    Token quote;
+    Exchange buyVenue;
+    Exchange sellVenue;
+    double profit;
+    std::array<uint64_t, STAGE_COUNT> buyLeg;
+    std::array<uint64_t, STAGE_COUNT> sellLeg;
+    uint64_t assembled;
+    uint64_t evaluated;
+    uint64_t riskChecked;
+    uint64_t dispatched;
+
+    static OpportunityTrace of(const Arber& arb, uint64_t riskChecked, uint64_t dispatched) {
+        return OpportunityTrace{
+            arb.buyToken, arb.sellToken, arb.buyExchange, arb.sellExchange, arb.profit,
+            {arb.buyBBO.exchangeAt, arb.buyBBO.receivedAt, arb.buyBBO.parsedAt},
+            {arb.sellBBO.exchangeAt, arb.sellBBO.receivedAt, arb.sellBBO.parsedAt},
+            arb.assembledAt, arb.evaluatedAt, riskChecked, dispatched
+        };
+    }
+
+    // Earliest stamp of the trace
+    uint64_t start() const {
+        uint64_t first = assembled;
+        for (const auto* leg : {&buyLeg, &sellLeg}) {
+            for (uint64_t stamp : *leg) {
+                if (stamp && (!first || stamp < first)) {
+                    first = stamp;
+                }
+            }
+        }
+        return first;
+    }
+};
+
+/**
+* @brief The last CAPACITY opportunity traces, exported in the Chrome trace
+* event format (chrome://tracing, Perfetto). Opportunities are rare next to
+* scans, so recording takes a lock; the scan path itself only stamps.
+*/
+class TraceRecorder {
+    public:
+        static constexpr size_t CAPACITY = 1024;
+
+        void record(const OpportunityTrace& trace) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (traces_.size() < CAPACITY) {
+                traces_.push_back(trace);
+            } else {
+                traces_[recorded_ % CAPACITY] = trace;
+            }
+            recorded_++;
+        }
+
+        // Oldest first
+        std::vector<OpportunityTrace> traces() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<OpportunityTrace> ordered;
+            ordered.reserve(traces_.size());
+            size_t first = traces_.size() < CAPACITY ? 0 : recorded_ % CAPACITY;
+            for (size_t i = 0; i < traces_.size(); i++) {
+                ordered.push_back(traces_[(first + i) % traces_.size()]);
+            }
+            return ordered;
+        }
+
+        uint64_t recorded() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return recorded_;
+        }
+
+        // One row per opportunity, one complete event per stage, times in us
+        void writeChromeTrace(std::ostream& out) const {
+            const auto all = traces();
+            std::ostringstream json;
+            json << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+
+            bool first = true;
+            auto event = [&](size_t row, const std::string& name, uint64_t from, uint64_t to) {
+                if (!from || !to || to < from) {
+                    return;
+                }
+                json << (first ? "\n" : ",\n")
+                     << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << row
+                     << ",\"ts\":" << from / 1000.0 << ",\"dur\":" << (to - from) / 1000.0 << "}";
+                first = false;
+            };
+
+            for (size_t row = 0; row < all.size(); row++) {
+                const OpportunityTrace& trace = all[row];
+                std::ostringstream label;
+                label << trace.base << trace.quote << " " << trace.buyVenue << " -> " << trace.sellVenue
+                      << " " << std::setprecision(4) << trace.profit << "%";
+                json << (first ? "\n" : ",\n")
+                     << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << row
+                     << ",\"args\":{\"name\":\"" << label.str() << "\"}}";
+                first = false;
+
+                event(row, "opportunity", trace.start(), trace.dispatched);
+                legEvents(event, row, "buy " + venueName(trace.buyVenue), trace.buyLeg);
+                legEvents(event, row, "sell " + venueName(trace.sellVenue), trace.sellLeg);
+                event(row, "wait for snapshot",
+                    std::max(trace.buyLeg[OpportunityTrace::PARSED], trace.sellLeg[OpportunityTrace::PARSED]),
+                    trace.assembled);
+                event(row, "evaluate", trace.assembled, trace.evaluated);
+                event(row, "risk check", trace.evaluated, trace.riskChecked);
+                event(row, "dispatch", trace.riskChecked, trace.dispatched);
+            }
+            json << "\n],\"displayTimeUnit\":\"ms\"}\n";
+            out << json.str();
+        }
+
+    private:
+        mutable std::mutex mutex_;
+        std::vector<OpportunityTrace> traces_;
+        uint64_t recorded_ = 0;
+
+        template<typename Event>
+        static void legEvents(Event& event, size_t row, const std::string& leg,
+                              const std::array<uint64_t, OpportunityTrace::STAGE_COUNT>& stamps) {
+            event(row, leg + " exchange to receive", stamps[OpportunityTrace::EXCHANGE], stamps[OpportunityTrace::RECEIVED]);
+            event(row, leg + " parse", stamps[OpportunityTrace::RECEIVED], stamps[OpportunityTrace::PARSED]);
+        }
+
+        static std::string venueName(Exchange venue) {
+            return EnumTraits<Exchange>::toString(venue);
+        }
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+* @brief L2 book for one instrument, kept as two flat sorted arrays of price
+* levels. Each side is stored worst to best so the top of book sits at the
+* back, where nearly all updates land and inserts/erases move few elements.
+*
+* Follows the Binance diff depth rules: a snapshot sets lastUpdateId, diffs
+* at or below it are stale, the first diff after it must straddle it and
+* every later diff must start right after the previous one. Anything else
+* is a gap and the book stays unsynced until the next snapshot.
+*/
+class OrderBook {
+    public:
+        enum class Result {
+            APPLIED,
+            STALE,          // already covered by the book, ignored
+            GAP,            // updates were missed, the book is now unsynced
+            NOT_SYNCED      // no snapshot since the last gap
+        };
+
+        using Levels = std::span<const PriceLevel>;
+
+        // Levels in any order, zero sizes are skipped
+        void applySnapshot(uint64_t lastUpdateId, Levels bids, Levels asks) {
+            load(bids_, bids, [](int64_t a, int64_t b) { return a < b; });
+            load(asks_, asks, [](int64_t a, int64_t b) { return a > b; });
+            lastUpdateId_ = lastUpdateId;
+            synced_ = true;
+            awaitingFirstDiff_ = true;
+        }
+
+        // Absolute sizes per level, zero removes the level
+        Result applyDiff(uint64_t firstUpdateId, uint64_t finalUpdateId, Levels bids, Levels asks) {
+            if (!synced_) {
+                return Result::NOT_SYNCED;
+            }
+            if (finalUpdateId <= lastUpdateId_) {
+                return Result::STALE;
+            }
+
+            bool inSequence = awaitingFirstDiff_
+                ? firstUpdateId <= lastUpdateId_ + 1
+                : firstUpdateId == lastUpdateId_ + 1;
+            if (!inSequence) {
+                synced_ = false;
+                return Result::GAP;
+            }
+
+            for (const auto& level : bids) {
+                update(bids_, level, [](int64_t a, int64_t b) { return a < b; });
+            }
+            for (const auto& level : asks) {
+                update(asks_, level, [](int64_t a, int64_t b) { return a > b; });
+            }
+
+            lastUpdateId_ = finalUpdateId;
+            awaitingFirstDiff_ = false;
+            return Result::APPLIED;
+        }
+
+        void clear() {
+            bids_.clear();
+            asks_.clear();
+            lastUpdateId_ = 0;
+            synced_ = false;
+        }
+
+        bool synced() const { return synced_; }
+        uint64_t lastUpdateId() const { return lastUpdateId_; }
+
+        size_t bidDepth() const { return bids_.size(); }
+        size_t askDepth() const { return asks_.size(); }
+
+        // Level n from the top, 0 is the best; zeroed past the end of the side
+        PriceLevel bid(size_t n = 0) const { return n < bids_.size() ? bids_[bids_.size() - 1 - n] : PriceLevel{}; }
+        PriceLevel ask(size_t n = 0) const { return n < asks_.size() ? asks_[asks_.size() - 1 - n] : PriceLevel{}; }
+
+        BBO bbo(uint64_t timestamp = 0) const { return BBO{bid(), ask(), timestamp}; }
+
+        // Size resting on the top n levels of a side
+        int64_t bidSize(size_t levels) const { return sizeOf(bids_, levels); }
+        int64_t askSize(size_t levels) const { return sizeOf(asks_, levels); }
+
+    private:
+        static constexpr size_t NEAR_TOP = 16;
+
+        // worst first, best at back()
+        std::vector<PriceLevel> bids_;
+        std::vector<PriceLevel> asks_;
+        uint64_t lastUpdateId_ = 0;
+        bool synced_ = false;
+        bool awaitingFirstDiff_ = false;
+
+        template<typename Worse>
+        static void load(std::vector<PriceLevel>& side, Levels levels, Worse worse) {
+            side.clear();
+            for (const auto& level : levels) {
+                if (level.size > 0) {
+                    side.push_back(level);
+                }
+            }
+            std::sort(side.begin(), side.end(),
+                [&](const PriceLevel& a, const PriceLevel& b) { return worse(a.price, b.price); });
+        }
+
+        template<typename Worse>
+        static void update(std::vector<PriceLevel>& side, const PriceLevel& level, Worse worse) {
+            // most updates land a few levels off the top, walk down from it first
+            auto it = side.end();
+            auto stop = side.end() - std::min<size_t>(side.size(), NEAR_TOP);
+            while (it != stop && worse(level.price, (it - 1)->price)) {
+                --it;
+            }
+            if (it == stop && it != side.begin() && worse(level.price, (it - 1)->price)) {
+                it = std::lower_bound(side.begin(), it, level.price,
+                    [&](const PriceLevel& a, int64_t price) { return worse(a.price, price); });
+            } else if (it != side.begin() && (it - 1)->price == level.price) {
+                --it;
+            }
+            bool found = it != side.end() && it->price == level.price;
+
+            if (level.size > 0) {
+                if (found) {
+                    it->size = level.size;
+                } else {
+                    side.insert(it, level);
+                }
+            } else if (found) {
+                side.erase(it);
+            }
+        }
+
+        static int64_t sizeOf(const std::vector<PriceLevel>& side, size_t levels) {
+            int64_t total = 0;
+            size_t n = std::min(levels, side.size());
+            for (size_t i = 0; i < n; i++) {
+                total += side[side.size() - 1 - i].size;
+            }
+            return total;
+        }
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "HttpBuffer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/**
+* @brief Token bucket for one venue's request weight budget. AsyncHttp asks it
+* before dispatching and feeds every response back, so the bucket follows the
+* usage the server reports and stops dead on 429/418 until Retry-After passes.
+*/
+class RateLimiter {
+    public:
+        struct Config {
+            // weight the venue allows per window, keep some headroom below the published limit
+            double capacity;
+            std::chrono::milliseconds window;
+            // header carrying the weight used so far in the window, empty when the venue sends none
+            std::string usage_header;
+            // pause after a 429/418 that came without Retry-After
+            std::chrono::milliseconds default_backoff{std::chrono::milliseconds(1000)};
+        };
+
+        struct Stats {
+            uint64_t granted;
+            uint64_t deferred;      // dispatch attempts held back for budget
+            uint64_t limited;       // 429/418 answers
+            double tokens;          // weight available right now
+        };
+
+        using Clock = std::chrono::steady_clock;
+
+        explicit RateLimiter(Config config)
+            : config_(std::move(config)), tokens_(config_.capacity), refilled_at_(Clock::now()) {}
+
+        // Takes weight from the bucket and returns zero, or returns how long
+        // until it would fit without taking anything
+        std::chrono::milliseconds try_acquire(uint32_t weight) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = Clock::now();
+            refill(now);
+
+            if (now < blocked_until_) {
+                stats_.deferred++;
+                return std::chrono::ceil<std::chrono::milliseconds>(blocked_until_ - now);
+            }
+
+            // a request heavier than the whole bucket goes once the bucket is full
+            double needed = std::min<double>(weight, config_.capacity);
+            if (tokens_ >= needed) {
+                tokens_ -= weight;
+                stats_.granted++;
+                return std::chrono::milliseconds(0);
+            }
+
+            stats_.deferred++;
+            double per_ms = config_.capacity / static_cast<double>(config_.window.count());
+            return std::chrono::milliseconds(static_cast<long>((needed - tokens_) / per_ms) + 1);
+        }
+
+        // Syncs with the server's count and honours rate limit answers
+        void observe(long status_code, const HttpHeaders& headers) {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (!config_.usage_header.empty()) {
+                uint64_t used = 0;
+                if (parse_count(headers.find(config_.usage_header), used)) {
+                    tokens_ = std::min(tokens_, config_.capacity - static_cast<double>(used));
+                }
+            }
+
+            // 429 is a warning, 418 means the IP is already banned
+            if (status_code == 429 || status_code == 418) {
+                stats_.limited++;
+
+                std::chrono::milliseconds pause = config_.default_backoff;
+                uint64_t seconds = 0;
+                if (parse_count(headers.find("Retry-After"), seconds)) {
+                    pause = std::chrono::seconds(seconds);
+                }
+
+                blocked_until_ = std::max(blocked_until_, Clock::now() + pause);
+                tokens_ = std::min(tokens_, 0.0);
+            }
+        }
+
+        Stats stats() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Stats stats = stats_;
+            stats.tokens = tokens_;
+            return stats;
+        }
+
+    private:
+        Config config_;
+        double tokens_;
+        Clock::time_point refilled_at_;
+        Clock::time_point blocked_until_{};
+        Stats stats_{};
+        mutable std::mutex mutex_;
+
+        void refill(Clock::time_point now) {
+            double elapsed_ms = std::chrono::duration<double, std::milli>(now - refilled_at_).count();
+            tokens_ = std::min(config_.capacity,
+                tokens_ + elapsed_ms * config_.capacity / static_cast<double>(config_.window.count()));
+            refilled_at_ = now;
+        }
+
+        // Plain decimal only, an HTTP-date Retry-After falls back to default_backoff
+        static bool parse_count(std::string_view text, uint64_t& out) {
+            auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+            return !text.empty() && result.ec == std::errc();
+        }
+};
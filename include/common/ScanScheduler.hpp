@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Instrument.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <vector>
+
+// How a ScanScheduler splits the pairs, defined outside it so it can be a
+// default argument. A cold pair waits up to a full sweep between two scans:
+// (pairs - hotPairs) / coldBatch cold batches plus the hot batches between
+// them, at one batch per worker per scan interval. That is roughly
+// pairs / coldBatch * (1 + 1 / coldPerRound) * interval / workers, so
+// 4096 pairs at the defaults with 2 workers every 100ms come round in ~6.4s.
+// Raise coldBatch to bound it for large universes.
+struct ScanSchedulerConfig {
+    // pairs scanned every round
+    size_t hotPairs = 16;
+    // pairs per cold batch, one bulk request per venue each
+    size_t coldBatch = 64;
+    // cold batches between two hot ones
+    size_t coldPerRound = 1;
+    // weight of the newest edge in a pair's activity
+    double alpha = 0.2;
+};
+
+/**
+* @brief Decides which pairs each scan covers once there are more pairs than
+* one scan should ask for. The pairs closest to crossing, by a decaying
+* average of their best cross venue edge, form the hot set that every round
+* scans; the others take turns in cold batches. A round is the hot batch and
+* coldPerRound cold ones whatever the pair count, so requests and CPU follow
+* the batch sizes and a bigger universe only means each cold pair comes round
+* less often. Workers share one scheduler, each batch goes to one of them.
+*/
+class ScanScheduler {
+    public:
+        using Config = ScanSchedulerConfig;
+
+        struct Batch {
+            // indices into pairs()
+            std::vector<size_t> pairs;
+            bool hot = false;
+        };
+
+        explicit ScanScheduler(std::vector<Instrument> pairs, Config config = {})
+            : pairs_(std::move(pairs)), config_(config),
+              activity_(pairs_.size(), UNSEEN), isHot_(pairs_.size(), false) {
+            config_.hotPairs = std::min(config_.hotPairs, pairs_.size());
+            config_.coldBatch = std::max<size_t>(config_.coldBatch, 1);
+            // everything is cold until the first hot batch ranks the pairs
+            coldSinceHot_ = config_.coldPerRound;
+        }
+
+        // The hot set when it is due and no worker holds it, the next cold
+        // batch otherwise. Empty when every pair is hot and already out.
+        Batch next() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const bool coldLeft = pairs_.size() > config_.hotPairs;
+            if (!hotOut_ && (coldSinceHot_ >= config_.coldPerRound || !coldLeft)) {
+                rank();
+                hotOut_ = true;
+                coldSinceHot_ = 0;
+                return Batch{hot_, true};
+            }
+            if (!coldLeft) {
+                return Batch{};
+            }
+
+            Batch batch;
+            for (size_t seen = 0; seen < pairs_.size() && batch.pairs.size() < config_.coldBatch; seen++) {
+                size_t pair = cursor_;
+                cursor_ = (cursor_ + 1) % pairs_.size();
+                if (!isHot_[pair]) {
+                    batch.pairs.push_back(pair);
+                }
+            }
+            coldSinceHot_++;
+            return batch;
+        }
+
+        // Hands a batch back with the edge each of its pairs showed, in order:
+        // best sell bid over buy ask across venues in %, NaN when the pair had
+        // fewer than two fresh quotes
+        void done(const Batch& batch, std::span<const double> edges) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < batch.pairs.size() && i < edges.size(); i++) {
+                if (std::isnan(edges[i])) {
+                    continue;
+                }
+                double& activity = activity_[batch.pairs[i]];
+                activity = activity == UNSEEN ? edges[i] : activity + config_.alpha * (edges[i] - activity);
+            }
+            if (batch.hot) {
+                hotOut_ = false;
+            }
+            scanned_ += batch.pairs.size();
+        }
+
+        std::vector<Instrument> instruments(const Batch& batch) const {
+            std::vector<Instrument> instruments;
+            instruments.reserve(batch.pairs.size());
+            for (size_t pair : batch.pairs) {
+                instruments.push_back(pairs_[pair]);
+            }
+            return instruments;
+        }
+
+        const std::vector<Instrument>& pairs() const { return pairs_; }
+
+        // Decaying average edge of the pair in %, lowest for pairs not seen yet
+        double activity(size_t pair) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return activity_[pair];
+        }
+
+        // The current hot set, best first
+        std::vector<size_t> hot() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return hot_;
+        }
+
+        // Pair scans handed back so far
+        uint64_t scanned() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return scanned_;
+        }
+
+    private:
+        static constexpr double UNSEEN = -std::numeric_limits<double>::infinity();
+
+        const std::vector<Instrument> pairs_;
+        Config config_;
+
+        mutable std::mutex mutex_;
+        std::vector<double> activity_;
+        std::vector<bool> isHot_;
+        std::vector<size_t> hot_;
+        bool hotOut_ = false;
+        size_t coldSinceHot_ = 0;
+        size_t cursor_ = 0;
+        uint64_t scanned_ = 0;
+
+        // Picks the hotPairs most active pairs, unseen pairs in their listed order
+        void rank() {
+            std::vector<size_t> order(pairs_.size());
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            auto busier = [this](size_t a, size_t b) {
+                return activity_[a] != activity_[b] ? activity_[a] > activity_[b] : a < b;
+            };
+            std::partial_sort(order.begin(), order.begin() + config_.hotPairs, order.end(), busier);
+
+            for (size_t pair : hot_) {
+                isHot_[pair] = false;
+            }
+            hot_.assign(order.begin(), order.begin() + config_.hotPairs);
+            for (size_t pair : hot_) {
+                isHot_[pair] = true;
+            }
+        }
+};
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Lazy coroutine task. Nothing runs until it is awaited, and the
+* awaiting coroutine resumes on whichever thread finished the task. With
+* AsyncHttp awaitables that is the http event loop, so no thread hops.
+*/
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+template<typename T>
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    // Hands control straight back to whoever awaited us
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase<T> {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+    T take() {
+        if (this->error) {
+            std::rethrow_exception(this->error);
+        }
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase<void> {
+    Task<void> get_return_object();
+
+    void return_void() {}
+
+    void take() {
+        if (this->error) {
+            std::rethrow_exception(this->error);
+        }
+    }
+};
+
+// Fire and forget frame, destroys itself once it runs to completion
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+template<typename T>
+class Task {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        Task() = default;
+        explicit Task(handle_type handle) : handle_(handle) {}
+
+        Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (handle_) {
+                    handle_.destroy();
+                }
+                handle_ = std::exchange(other.handle_, {});
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task() {
+            if (handle_) {
+                handle_.destroy();
+            }
+        }
+
+        bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle_.promise().continuation = awaiting;
+            return handle_;
+        }
+
+        T await_resume() { return handle_.promise().take(); }
+
+    private:
+        handle_type handle_;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+template<typename T>
+struct SyncWaitState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::optional<T> value;
+    std::exception_ptr error;
+};
+
+template<>
+struct SyncWaitState<void> {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::exception_ptr error;
+};
+
+template<typename T>
+DetachedTask sync_wait_runner(Task<T> task, SyncWaitState<T>* state) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(task);
+        } else {
+            state->value.emplace(co_await std::move(task));
+        }
+    } catch (...) {
+        state->error = std::current_exception();
+    }
+
+    // Notify under the lock, the waiter frees state as soon as it sees done
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->done = true;
+    state->cv.notify_one();
+}
+
+template<typename T>
+struct WhenAllState {
+    std::vector<std::optional<T>> results;
+    std::vector<std::exception_ptr> errors;
+    // one per task plus one held by the awaiter until everything is started
+    std::atomic<size_t> remaining;
+    std::coroutine_handle<> continuation;
+};
+
+template<typename T>
+DetachedTask when_all_runner(Task<T> task, WhenAllState<T>* state, size_t index) {
+    try {
+        state->results[index].emplace(co_await std::move(task));
+    } catch (...) {
+        state->errors[index] = std::current_exception();
+    }
+
+    if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        state->continuation.resume();
+    }
+}
+
+template<typename T>
+struct WhenAllAwaiter {
+    std::vector<Task<T>> tasks;
+    WhenAllState<T> state;
+
+    bool await_ready() const noexcept { return tasks.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        state.results.resize(tasks.size());
+        state.errors.resize(tasks.size());
+        state.remaining.store(tasks.size() + 1, std::memory_order_relaxed);
+        state.continuation = awaiting;
+
+        for (size_t i = 0; i < tasks.size(); i++) {
+            when_all_runner(std::move(tasks[i]), &state, i);
+        }
+
+        // Stay suspended unless every task already finished inline
+        return state.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    std::vector<T> await_resume() {
+        for (auto& error : state.errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        std::vector<T> values;
+        values.reserve(state.results.size());
+        for (auto& result : state.results) {
+            values.push_back(std::move(*result));
+        }
+        return values;
+    }
+};
+
+template<typename T>
+struct DeadlineState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::optional<T>> results;
+    size_t remaining = 0;
+    // finished tasks whose result counts, the waiter leaves once quorum do
+    size_t counted = 0;
+    size_t quorum = 0;
+    std::function<bool(const T&)> counts;
+    // whatever the tasks borrow, released with the last of them
+    std::shared_ptr<const void> borrowed;
+    // one per task plus the waiter, the waiter may be gone when a late task ends
+    std::atomic<size_t> refs;
+
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+};
+
+// Takes a raw pointer, GCC 12 mishandles non trivial coroutine parameters
+template<typename T>
+DetachedTask deadline_runner(Task<T> task, DeadlineState<T>* state, size_t index) {
+    std::optional<T> result;
+    try {
+        result.emplace(co_await std::move(task));
+    } catch (...) {
+        // a failed task is reported like a late one
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (result && (!state->counts || state->counts(*result))) {
+            state->counted++;
+        }
+        state->results[index] = std::move(result);
+        state->remaining--;
+        state->cv.notify_one();
+    }
+    state->release();
+}
+
+} // namespace detail
+
+/**
+* @brief Block the calling thread until the task finishes, for code outside
+* any coroutine.
+*/
+template<typename T>
+T sync_wait(Task<T> task) {
+    detail::SyncWaitState<T> state;
+    detail::sync_wait_runner(std::move(task), &state);
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.cv.wait(lock, [&state]() { return state.done; });
+
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*state.value);
+    }
+}
+
+/**
+* @brief Run every task concurrently and resume once all of them are done.
+* Results keep the order of the input.
+*/
+template<typename T>
+Task<std::vector<T>> when_all(std::vector<Task<T>> tasks) {
+    // Named rather than a temporary, GCC 12 destroys aggregate temporaries
+    // inside co_await twice
+    detail::WhenAllAwaiter<T> awaiter{std::move(tasks), {}};
+    co_return co_await awaiter;
+}
+
+/**
+* @brief Start every task at once and block until all are done or the
+* deadline passes, whichever comes first. Tasks that failed or had not
+* finished by then come back empty; late ones still run to completion in
+* the background, so anything they point into must be handed over as
+* borrowed to stay alive until they do.
+*
+* With a quorum the wait also ends as soon as that many tasks finished with
+* a result counts accepts, the rest are then treated as late.
+*/
+template<typename T>
+std::vector<std::optional<T>> sync_wait_until(std::vector<Task<T>> tasks,
+                                              std::chrono::steady_clock::time_point deadline,
+                                              std::shared_ptr<const void> borrowed = nullptr,
+                                              size_t quorum = 0,
+                                              std::function<bool(const T&)> counts = {}) {
+    auto* state = new detail::DeadlineState<T>();
+    state->results.resize(tasks.size());
+    state->remaining = tasks.size();
+    state->quorum = quorum == 0 ? tasks.size() : quorum;
+    state->counts = std::move(counts);
+    state->borrowed = std::move(borrowed);
+    state->refs.store(tasks.size() + 1, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < tasks.size(); i++) {
+        detail::deadline_runner(std::move(tasks[i]), state, i);
+    }
+
+    std::vector<std::optional<T>> results;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait_until(lock, deadline, [state]() {
+            return state->remaining == 0 || state->counted >= state->quorum;
+        });
+        results = std::move(state->results);
+        // late tasks write into fresh slots nobody reads
+        state->results.resize(results.size());
+    }
+    state->release();
+    return results;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+// steady_clock nanoseconds, the clock every trace stamp is taken on
+inline uint64_t traceNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+* @brief Places a venue's own quote timestamps on the local steady clock.
+* A quote cannot be stamped after its answer reached us, so venue time minus
+* local arrival time bounds how far the venue's clock runs ahead of ours
+* from below; the tightest bound of the last two windows of samples is the
+* estimate. It is short by the quickest one way trip seen, so exchange to
+* receive reads as time above the best trip rather than absolute latency.
+*/
+class ClockOffset {
+    public:
+        static constexpr uint32_t WINDOW = 256;
+
+        // venueMs is the venue's epoch ms stamp, receivedAt when the answer
+        // carrying it arrived (steady ns). Feeds the estimate and returns the
+        // stamp on the steady clock, 0 when the venue sent none.
+        uint64_t toLocal(uint64_t venueMs, uint64_t receivedAt) {
+            if (venueMs == 0 || receivedAt == 0) {
+                return 0;
+            }
+            const int64_t wallToSteady = wallNow() - static_cast<int64_t>(traceNow());
+            const int64_t venueWall = static_cast<int64_t>(venueMs) * 1000000;
+            const int64_t bound = venueWall - (static_cast<int64_t>(receivedAt) + wallToSteady);
+
+            int64_t lead;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                current_ = std::max(current_, bound);
+                if (++samples_ == WINDOW) {
+                    previous_ = current_;
+                    current_ = NONE;
+                    samples_ = 0;
+                }
+                lead = std::max(previous_, current_);
+            }
+            lead_.store(lead, std::memory_order_relaxed);
+
+            int64_t local = venueWall - wallToSteady - lead;
+            return local > 0 ? static_cast<uint64_t>(local) : 0;
+        }
+
+        // Current estimate of the venue clock's lead over ours in ns
+        int64_t lead() const { return lead_.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr int64_t NONE = std::numeric_limits<int64_t>::min();
+
+        std::mutex mutex_;
+        int64_t current_ = NONE;
+        int64_t previous_ = NONE;
+        uint32_t samples_ = 0;
+        std::atomic<int64_t> lead_{0};
+
+        static int64_t wallNow() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+* @brief Minimal RFC 6455 client on top of a curl CONNECT_ONLY connection.
+* curl does TCP, TLS and proxies, the handshake and framing are done here.
+* One thread per client reads frames, answers pings and reconnects with
+* backoff whenever the connection drops or goes quiet.
+*/
+class WebSocketClient {
+    public:
+        struct Options {
+            std::chrono::milliseconds connect_timeout{3000};
+            // ws ping cadence, and how long without any frame counts as dead
+            std::chrono::milliseconds ping_interval{10000};
+            std::chrono::milliseconds idle_timeout{30000};
+            std::chrono::milliseconds reconnect_min{100};
+            std::chrono::milliseconds reconnect_max{5000};
+            // application level text keepalive sent every ping_interval, some venues want one
+            std::string heartbeat;
+        };
+
+        // All handlers run on the client's thread
+        using OpenHandler = std::function<void()>;
+        using MessageHandler = std::function<void(std::string_view)>;
+        using CloseHandler = std::function<void()>;
+
+        explicit WebSocketClient(std::string url);
+        WebSocketClient(std::string url, Options options);
+        ~WebSocketClient();
+
+        WebSocketClient(const WebSocketClient&) = delete;
+        WebSocketClient& operator=(const WebSocketClient&) = delete;
+
+        void start(OpenHandler on_open, MessageHandler on_message, CloseHandler on_close);
+        void stop();
+
+        // Queues a text frame, safe from any thread. Dropped while disconnected,
+        // on_open is where subscriptions get (re)sent.
+        bool send(std::string_view text);
+
+        bool connected() const { return connected_.load(std::memory_order_acquire); }
+        uint64_t connects() const { return connects_.load(); }
+
+        // Sec-WebSocket-Accept for a Sec-WebSocket-Key, also used by stand-in servers
+        static std::string accept_key(std::string_view key);
+
+    private:
+        enum Opcode : uint8_t {
+            CONTINUATION = 0x0,
+            TEXT = 0x1,
+            BINARY = 0x2,
+            CLOSE = 0x8,
+            PING = 0x9,
+            PONG = 0xA
+        };
+
+        std::string url_;
+        Options options_;
+        // curl URL, Host header and request path derived from url_
+        std::string connect_url_;
+        std::string host_;
+        std::string path_;
+
+        OpenHandler on_open_;
+        MessageHandler on_message_;
+        CloseHandler on_close_;
+
+        std::thread thread_;
+        std::atomic<bool> running_{false};
+        std::atomic<bool> connected_{false};
+        std::atomic<uint64_t> connects_{0};
+        // wakes the thread from poll and from the reconnect backoff
+        int wake_pipe_[2] = {-1, -1};
+        std::mutex backoff_mutex_;
+        std::condition_variable backoff_cv_;
+
+        std::mutex outbox_mutex_;
+        std::vector<std::string> outbox_;
+
+        // connection state, only touched by the client thread
+        CURL* curl_ = nullptr;
+        curl_socket_t socket_ = CURL_SOCKET_BAD;
+        std::string in_;
+        // fragmented message being reassembled
+        std::string message_;
+
+        void run();
+        bool open_connection();
+        void close_connection();
+        // Reads frames until the connection drops, goes idle or stop() is called
+        void read_loop();
+        // Parses whole frames off in_, false once the server closed
+        bool consume_frames();
+        bool flush_outbox();
+        bool send_frame(Opcode opcode, std::string_view payload);
+        bool send_all(std::string_view data);
+        // -1 on error, 0 when nothing is buffered, else bytes appended to in_
+        long receive();
+        void wake();
+};
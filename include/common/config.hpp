@@ -2,13 +2,19 @@
 
 #include <cstdint>
 
+// Fixed point, price in ticks and size in lots of the pair's PairScale
 struct PriceLevel {
-    double price;
-    double size;
+    int64_t price;
+    int64_t size;
 };
 
 struct BBO {
     PriceLevel bid;
     PriceLevel ask;
     uint64_t timestamp;
+    // Trace stamps in steady_clock ns, 0 when unknown: the venue's own stamp
+    // placed on our clock, the answer or frame arriving and parse done
+    uint64_t exchangeAt = 0;
+    uint64_t receivedAt = 0;
+    uint64_t parsedAt = 0;
 };
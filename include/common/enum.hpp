@@ -1,9 +1,10 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 template<typename EnumType>
 struct EnumTraits {
-    static EnumType fromString(const std::string& str);
+    static EnumType fromString(std::string_view str);
     static std::string toString(const EnumType value);
 };
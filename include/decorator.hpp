@@ -1,12 +1,13 @@
 #pragma once
 
+#include "common/FixedPoint.hpp"
 #include "common/Gateway.hpp"
-#include "utils/logs.hpp"
+#include "utils/AsyncLogger.hpp"
 
-#include <fstream>
-#include <ctime>
 #include <iostream>
 #include <chrono>
+#include <span>
+#include <vector>
 
 class GatewayDecorator : public Gateway {
     protected:
@@ -22,10 +23,42 @@ class GatewayDecorator : public Gateway {
             return gw->getBBO(base, quote);
         }
 
+        virtual Task<BBO> getBBOAsync(Token base, Token quote) override {
+            return gw->getBBOAsync(base, quote);
+        }
+
+        virtual Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            return gw->getBBOsAsync(instruments);
+        }
+
         virtual std::string getTicker(Token& base, Token& quote) override {
             return gw->getTicker(base, quote);
         }
 
+        virtual size_t prewarm() override {
+            return gw->prewarm();
+        }
+
+        virtual std::vector<Listing> listings() override {
+            return gw->listings();
+        }
+
+        virtual void subscribe(Token base, Token quote) override {
+            gw->subscribe(base, quote);
+        }
+
+        virtual LatencyRecorder& latency() override {
+            return gw->latency();
+        }
+
+        virtual AsyncHttp::LoadStats httpLoad() const override {
+            return gw->httpLoad();
+        }
+
+        virtual int64_t clockLead() const override {
+            return gw->clockLead();
+        }
+
         virtual ~GatewayDecorator() {
             delete gw;
         }
@@ -33,174 +66,194 @@ class GatewayDecorator : public Gateway {
 
 class LoggingDecorator : public GatewayDecorator {
     private:
-        std::ofstream logFile;
-
-        void checkAndClearLog() {
-            if (shouldClearLog()) {
-                logFile.close();
-                logFile.open("exchange_logs.txt", std::ios::trunc);
-                logFile.close();
-                logFile.open("exchange_logs.txt", std::ios::app);
-            }
-        }
+        AsyncLogger& logger;
 
     public:
-        LoggingDecorator(Gateway* gw) : GatewayDecorator(gw) {
-            logFile.open("exchange_logs.txt", std::ios::app);
-        }
+        LoggingDecorator(Gateway* gw, AsyncLogger& logger = AsyncLogger::shared())
+            : GatewayDecorator(gw), logger(logger) {}
 
         BBO getBBO(Token base, Token quote) override {
-            checkAndClearLog();
-
             BBO bbo = gw->getBBO(base, quote);
-
-            logFile << "[" << std::time(nullptr) << "] "
-                    << name << " " << base << quote
-                    << " Bid: " << bbo.bid.price << "@" << bbo.bid.size
-                    << " Ask: " << bbo.ask.price << "@" << bbo.ask.size
-                    << std::endl;
+            log(base, quote, bbo);
 
             return bbo;
         }
 
-        ~LoggingDecorator() {
-            logFile.close();
+        Task<BBO> getBBOAsync(Token base, Token quote) override {
+            BBO bbo = co_await gw->getBBOAsync(base, quote);
+            log(base, quote, bbo);
+
+            co_return bbo;
+        }
+
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            std::vector<BBO> bbos = co_await gw->getBBOsAsync(instruments);
+            for (size_t i = 0; i < bbos.size(); i++) {
+                log(instruments[i].baseSymbol, instruments[i].quoteSymbol, bbos[i]);
+            }
+
+            co_return bbos;
+        }
+
+        void log(Token base, Token quote, const BBO& bbo) {
+            logger.quote(name, base, quote, bbo);
         }
 };
 
 class LatencyDecorator : public GatewayDecorator {
     private:
-        std::ofstream logFile;
+        AsyncLogger& logger;
 
     public:
-        LatencyDecorator(Gateway* gw) : GatewayDecorator(gw) {
-            logFile.open("exchange_logs.txt", std::ios::app);
-        }
+        LatencyDecorator(Gateway* gw, AsyncLogger& logger = AsyncLogger::shared())
+            : GatewayDecorator(gw), logger(logger) {}
 
         BBO getBBO(Token base, Token quote) override {
-            auto start = std::chrono::high_resolution_clock::now();
+            auto start = std::chrono::steady_clock::now();
 
             BBO bbo = gw->getBBO(base, quote);
+            log(start);
 
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            return bbo;
+        }
 
-            logFile << "[LATENCY] " << name << " request took "
-                    << duration.count() << "ms" << std::endl;
+        Task<BBO> getBBOAsync(Token base, Token quote) override {
+            auto start = std::chrono::steady_clock::now();
 
-            return bbo;
+            BBO bbo = co_await gw->getBBOAsync(base, quote);
+            log(start);
+
+            co_return bbo;
         }
 
-        ~LatencyDecorator() {
-            logFile.close();
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<BBO> bbos = co_await gw->getBBOsAsync(instruments);
+            log(start);
+
+            co_return bbos;
         }
-};
 
-class ArbLogDecorator {
-    private:
-        std::ofstream logFile;
-
-        void checkAndClearLog() {
-            if (shouldClearLog()) {
-                logFile.close();
-                logFile.open("arbitrage_logs.txt", std::ios::trunc);
-                logFile.close();
-                logFile.open("arbitrage_logs.txt", std::ios::app);
-            }
+        void log(std::chrono::steady_clock::time_point start) {
+            logger.latency(name, std::chrono::steady_clock::now() - start);
         }
+};
 
+/**
+* @brief Compile time counterparts of the decorators above, layered by
+* inheritance: Instrumented<Logged<BinanceGateway>> is a single gateway
+* object with one http client. The bot still holds it as a Gateway*, so the
+* only virtual hop is at that boundary; every layer below calls the next one
+* by qualified name and the compiler can inline the chain.
+*/
+template<typename Inner>
+class Logged : public Inner {
     public:
-        ArbLogDecorator() {
-            logFile.open(
-                "arbitrage_logs.txt",
-                std::ios::app
-            );
+        using Inner::Inner;
+
+        BBO getBBO(Token base, Token quote) override {
+            BBO bbo = Inner::getBBO(base, quote);
+            AsyncLogger::shared().quote(this->name, base, quote, bbo);
+            return bbo;
         }
 
-        void logOpportunity(const Arber& arb) {
-            checkAndClearLog();
-            std::string timestamp = std::to_string(std::time(nullptr));
-
-            logFile << "[" << timestamp << "] "
-                    << "Buy: " << arb.buyExchange
-                    << " @ " << arb.buyBBO.ask.price
-                    << " Sell: " << arb.sellExchange
-                    << " @ " << arb.sellBBO.bid.price
-                    << " Amount: " << arb.amount
-                    << " Spread: " << (arb.sellBBO.bid.price - arb.buyBBO.ask.price)
-                    << " Profit: " << arb.profit << " %"
-                    << std::endl;
+        Task<BBO> getBBOAsync(Token base, Token quote) override {
+            auto fetch = Inner::getBBOAsync(base, quote);
+            BBO bbo = co_await fetch;
+            AsyncLogger::shared().quote(this->name, base, quote, bbo);
+            co_return bbo;
+        }
 
-            // Also print to console
-            std::cout << "\n=== Arbitrage Opportunity Found! ===" << std::endl;
-            std::cout << "Buy from: " << arb.buyExchange
-                        << " at " << arb.buyBBO.ask.price << std::endl;
-            std::cout << "Sell to: " << arb.sellExchange
-                        << " at " << arb.sellBBO.bid.price << std::endl;
-            std::cout << "Amount: " << arb.amount << std::endl;
-            std::cout << "Spread: " << (arb.sellBBO.bid.price - arb.buyBBO.ask.price) << std::endl
-            << "Profit: " << arb.profit << " %" << std::endl;
-            std::cout << "==============================\n" << std::endl;
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            auto fetch = Inner::getBBOsAsync(instruments);
+            std::vector<BBO> bbos = co_await fetch;
+            for (size_t i = 0; i < bbos.size(); i++) {
+                AsyncLogger::shared().quote(this->name, instruments[i].baseSymbol, instruments[i].quoteSymbol, bbos[i]);
+            }
+            co_return bbos;
         }
+};
 
-        void logRiskCheckFailed(const Arber& arb) {
-            checkAndClearLog();
-            std::string timestamp = std::to_string(std::time(nullptr));
+template<typename Inner>
+class Instrumented : public Inner {
+    public:
+        using Inner::Inner;
 
-            logFile << "[" << timestamp << "] RISK CHECK FAILED - "
-                    << "Buy: " << arb.buyExchange
-                    << " Sell: " << arb.sellExchange
-                    << " Amount: " << arb.amount
-                    << " Profit: " << arb.profit << "%"
-                    << std::endl;
+        BBO getBBO(Token base, Token quote) override {
+            auto start = std::chrono::steady_clock::now();
+            BBO bbo = Inner::getBBO(base, quote);
+            AsyncLogger::shared().latency(this->name, std::chrono::steady_clock::now() - start);
+            return bbo;
+        }
 
-            std::cout << "\n=== Risk Check Failed ===" << std::endl;
-            std::cout << "Trade rejected due to risk parameters" << std::endl;
-            std::cout << "=====================\n" << std::endl;
+        Task<BBO> getBBOAsync(Token base, Token quote) override {
+            auto start = std::chrono::steady_clock::now();
+            auto fetch = Inner::getBBOAsync(base, quote);
+            BBO bbo = co_await fetch;
+            AsyncLogger::shared().latency(this->name, std::chrono::steady_clock::now() - start);
+            co_return bbo;
         }
 
-        ~ArbLogDecorator() {
-            logFile.close();
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            auto start = std::chrono::steady_clock::now();
+            auto fetch = Inner::getBBOsAsync(instruments);
+            std::vector<BBO> bbos = co_await fetch;
+            AsyncLogger::shared().latency(this->name, std::chrono::steady_clock::now() - start);
+            co_return bbos;
         }
 };
 
-
-class ArbLatencyDecorator {
+class ArbLogDecorator {
     private:
-        std::ofstream logFile;
-
-        void checkAndClearLog() {
-            if (shouldClearLog()) {
-                logFile.close();
-                logFile.open("arbitrage_latency.txt", std::ios::trunc);
-                logFile.close();
-                logFile.open("arbitrage_latency.txt", std::ios::app);
-            }
-        }
+        AsyncLogger& logger;
 
     public:
-        ArbLatencyDecorator() {
-            logFile.open("arbitrage_latency.txt", std::ios::app);
+        ArbLogDecorator(AsyncLogger& logger = AsyncLogger::shared()) : logger(logger) {}
+
+        void logOpportunity(const Arber& arb) {
+            logger.opportunity(arb);
+
+            // Also print to console
+            std::cout << "\n=== Arbitrage Opportunity Found! ===\n"
+                      << "Buy from: " << arb.buyExchange << " at " << arb.buyPrice() << "\n"
+                      << "Sell to: " << arb.sellExchange << " at " << arb.sellPrice() << "\n"
+                      << "Amount: " << arb.amount << "\n"
+                      << "Spread: " << arb.spread() << "\n"
+                      << "Profit: " << arb.profit << " %\n"
+                      << "==============================\n" << std::endl;
         }
 
-        auto start() {
-            return std::chrono::high_resolution_clock::now();
+        void logRiskCheckFailed(const Arber& arb) {
+            logger.riskCheckFailed(arb);
+
+            std::cout << "\n=== Risk Check Failed ===\n"
+                      << "Trade rejected due to risk parameters\n"
+                      << "=====================\n" << std::endl;
         }
+};
 
-        void end(std::chrono::time_point<std::chrono::high_resolution_clock> start_time) {
-            checkAndClearLog();
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start_time);
 
-            std::string timestamp = std::to_string(std::time(nullptr));
+class ArbLatencyDecorator {
+    private:
+        AsyncLogger& logger;
+        LatencyHistogram scans;
 
-            logFile << "[" << timestamp << "] "
-                    << "Scan duration: " << duration.count() << "ms" << std::endl;
+    public:
+        ArbLatencyDecorator(AsyncLogger& logger = AsyncLogger::shared()) : logger(logger) {}
+
+        const LatencyHistogram& histogram() const { return scans; }
 
-            std::cout << "Scan completed in " << duration.count() << "ms" << std::endl;
+        auto start() {
+            return std::chrono::steady_clock::now();
         }
 
-        ~ArbLatencyDecorator() {
-            logFile.close();
+        void end(std::chrono::steady_clock::time_point start_time) {
+            auto took = std::chrono::steady_clock::now() - start_time;
+            logger.scan(took);
+            scans.record(std::chrono::duration_cast<std::chrono::nanoseconds>(took).count());
+
+            std::cout << "Scan completed in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(took).count() << "ms\n";
         }
 };
@@ -50,17 +50,20 @@ public:
     VolatilityStrategy(double limit) : maxVolatility(limit) {}
 
     bool validateTrade(const Arber& opportunity, const RiskMetrics& metrics) override {
-        double spread = opportunity.sellBBO.bid.price - opportunity.buyBBO.ask.price;
+        double spread = opportunity.spread();
         return std::abs(spread) <= maxVolatility;
     }
 };
 
 #include "risk/risk.hpp"
+#include <mutex>
 #include <vector>
 
 class RiskManager {
 private:
     std::vector<IRiskStrategy*> strategies;
+    // written by the risk thread, read by every scan
+    std::mutex metricsMutex;
     RiskMetrics metrics;
 
 public:
@@ -80,12 +83,19 @@ public:
     }
 
     void updateMetrics(const RiskMetrics& newMetrics) {
+        std::lock_guard<std::mutex> lock(metricsMutex);
         metrics = newMetrics;
     }
 
+    // Checks against a copy, an update never waits on the strategies
     bool validateArbitrage(const Arber& opportunity) {
+        RiskMetrics current;
+        {
+            std::lock_guard<std::mutex> lock(metricsMutex);
+            current = metrics;
+        }
         for (auto* strategy : strategies) {
-            if (!strategy->validateTrade(opportunity, metrics)) {
+            if (!strategy->validateTrade(opportunity, current)) {
                 return false;
             }
         }
@@ -0,0 +1,348 @@
+#pragma once
+
+#include "common/Arber.hpp"
+#include "common/FixedPoint.hpp"
+#include "common/Instrument.hpp"
+#include "common/config.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+* @brief One log entry, 64 bytes of plain data. The hot path fills it with a
+* handful of stores and the writer thread copies it to disk untouched;
+* cexa_logcat turns the files back into text.
+*
+* values by kind:
+*   QUOTE              bid price, bid size, ask price, ask size, venue timestamp ms
+*   LATENCY            request ns
+*   OPPORTUNITY        buy ask price, sell bid price, amount and profit (double bits)
+*   RISK_CHECK_FAILED  as OPPORTUNITY
+*   SCAN               scan ns
+*   TOKEN              name of token base, reserved bytes long and cut at 40
+*
+* Token values follow the writing process's intern order, so before the
+* first record of a file that names a token, the writer puts a TOKEN record
+* for it. Files appended to by a later process get that process's names.
+*/
+struct LogRecord {
+    enum class Kind : uint8_t {
+        QUOTE,
+        LATENCY,
+        OPPORTUNITY,
+        RISK_CHECK_FAILED,
+        SCAN,
+        TOKEN
+    };
+
+    uint64_t timestamp;         // ns since the epoch
+    Kind kind;
+    uint8_t venue;              // Exchange, the buy side of an opportunity
+    uint8_t otherVenue;         // sell side of an opportunity
+    uint8_t priceDecimals;
+    uint8_t sizeDecimals;
+    uint8_t reserved;
+    uint16_t base;              // Token, named by the token table of the writing process
+    uint16_t quote;
+    uint8_t padding[6];
+    int64_t values[5];
+};
+
+static_assert(sizeof(LogRecord) == 64, "LogRecord is written to disk as is");
+
+/**
+* @brief Process wide asynchronous binary logger. Producers claim a slot of a
+* bounded lock free ring and copy a LogRecord in; when the ring is full the
+* record is dropped and counted, a producer never waits. A single writer
+* thread drains the ring into one file per log and day, named like
+* exchange_logs-20250116.bin, and rotates at UTC midnight.
+*/
+class AsyncLogger {
+    public:
+        static constexpr size_t CAPACITY = 1 << 16;
+        // file header, followed by the record size as one byte
+        static constexpr char MAGIC[8] = {'C', 'E', 'X', 'A', 'L', 'O', 'G', '2'};
+
+        // The logs records of each kind go to, matching the old text files
+        static constexpr std::array<const char*, 3> LOGS = {"exchange_logs", "arbitrage_logs", "arbitrage_latency"};
+
+        static size_t logOf(LogRecord::Kind kind) {
+            switch (kind) {
+                case LogRecord::Kind::QUOTE:
+                case LogRecord::Kind::LATENCY:
+                    return 0;
+                case LogRecord::Kind::OPPORTUNITY:
+                case LogRecord::Kind::RISK_CHECK_FAILED:
+                    return 1;
+                default:
+                    return 2;
+            }
+        }
+
+        // Kinds whose base and quote name a pair
+        static bool hasPair(LogRecord::Kind kind) {
+            return kind == LogRecord::Kind::QUOTE || kind == LogRecord::Kind::OPPORTUNITY ||
+                   kind == LogRecord::Kind::RISK_CHECK_FAILED;
+        }
+
+        // The name a TOKEN record carries
+        static std::string tokenName(const LogRecord& record) {
+            return std::string(reinterpret_cast<const char*>(record.values),
+                std::min<size_t>(record.reserved, sizeof(record.values)));
+        }
+
+        // The one every decorator writes through, files land in the working directory
+        static AsyncLogger& shared() {
+            static AsyncLogger logger(".");
+            return logger;
+        }
+
+        explicit AsyncLogger(std::string directory)
+            : directory_(std::move(directory)), slots_(new Slot[CAPACITY]), running_(true) {
+            for (size_t i = 0; i < CAPACITY; i++) {
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            writer_ = std::thread(&AsyncLogger::drainLoop, this);
+        }
+
+        AsyncLogger(const AsyncLogger&) = delete;
+        AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+        // Everything logged before this point still reaches the files
+        ~AsyncLogger() {
+            running_.store(false, std::memory_order_release);
+            writer_.join();
+            for (auto& file : files_) {
+                if (file.handle) {
+                    std::fclose(file.handle);
+                }
+            }
+        }
+
+        // False when the ring was full and the record dropped
+        bool write(const LogRecord& record) {
+            uint64_t pos = head_.load(std::memory_order_relaxed);
+            while (true) {
+                Slot& slot = slots_[pos & (CAPACITY - 1)];
+                uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+                int64_t lag = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+
+                if (lag == 0) {
+                    if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        slot.record = record;
+                        slot.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (lag < 0) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    pos = head_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void quote(Exchange venue, Token base, Token quote, const BBO& bbo) {
+            LogRecord record = make(LogRecord::Kind::QUOTE, venue, base, quote);
+            record.values[0] = bbo.bid.price;
+            record.values[1] = bbo.bid.size;
+            record.values[2] = bbo.ask.price;
+            record.values[3] = bbo.ask.size;
+            record.values[4] = static_cast<int64_t>(bbo.timestamp);
+            write(record);
+        }
+
+        void latency(Exchange venue, std::chrono::nanoseconds took) {
+            LogRecord record = make(LogRecord::Kind::LATENCY, venue, Token::BTC, Token::BTC);
+            record.values[0] = took.count();
+            write(record);
+        }
+
+        void opportunity(const Arber& arb) {
+            write(arbitrage(LogRecord::Kind::OPPORTUNITY, arb));
+        }
+
+        void riskCheckFailed(const Arber& arb) {
+            write(arbitrage(LogRecord::Kind::RISK_CHECK_FAILED, arb));
+        }
+
+        void scan(std::chrono::nanoseconds took) {
+            LogRecord record = make(LogRecord::Kind::SCAN, Exchange::BINANCE, Token::BTC, Token::BTC);
+            record.values[0] = took.count();
+            write(record);
+        }
+
+        // Blocks until every record written before the call is in the files
+        void flush() {
+            uint64_t target = head_.load(std::memory_order_acquire);
+            while (flushed_.load(std::memory_order_acquire) < target) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+        // Path of a log's file for the UTC day of timestamp (ns since the epoch)
+        std::string pathFor(size_t log, uint64_t timestamp) const {
+            using namespace std::chrono;
+            year_month_day day{floor<days>(sys_time<nanoseconds>(nanoseconds(timestamp)))};
+            char date[16];
+            std::snprintf(date, sizeof(date), "%04d%02u%02u",
+                static_cast<int>(day.year()), static_cast<unsigned>(day.month()), static_cast<unsigned>(day.day()));
+            return directory_ + "/" + LOGS[log] + "-" + date + ".bin";
+        }
+
+    private:
+        static constexpr size_t BATCH = 1024;
+        static constexpr uint64_t NS_PER_DAY = 86400ull * 1000000000ull;
+
+        struct Slot {
+            std::atomic<uint64_t> sequence;
+            LogRecord record;
+        };
+
+        struct File {
+            std::FILE* handle = nullptr;
+            uint64_t day = 0;
+            // tokens this process already named in the file
+            std::vector<bool> named;
+        };
+
+        std::string directory_;
+        std::unique_ptr<Slot[]> slots_;
+        // producers and the writer on separate lines
+        alignas(64) std::atomic<uint64_t> head_{0};
+        alignas(64) uint64_t tail_ = 0;
+        std::atomic<uint64_t> flushed_{0};
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<bool> running_;
+        std::array<File, LOGS.size()> files_;
+        std::thread writer_;
+
+        static LogRecord make(LogRecord::Kind kind, Exchange venue, Token base, Token quote) {
+            LogRecord record{};
+            record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            record.kind = kind;
+            record.venue = static_cast<uint8_t>(venue);
+            record.base = static_cast<uint16_t>(base);
+            record.quote = static_cast<uint16_t>(quote);
+            PairScale scale = scaleOf(base, quote);
+            record.priceDecimals = scale.priceDecimals;
+            record.sizeDecimals = scale.sizeDecimals;
+            return record;
+        }
+
+        static LogRecord arbitrage(LogRecord::Kind kind, const Arber& arb) {
+            LogRecord record = make(kind, arb.buyExchange, arb.buyToken, arb.sellToken);
+            record.otherVenue = static_cast<uint8_t>(arb.sellExchange);
+            record.values[0] = arb.buyBBO.ask.price;
+            record.values[1] = arb.sellBBO.bid.price;
+            record.values[2] = std::bit_cast<int64_t>(arb.amount);
+            record.values[3] = std::bit_cast<int64_t>(arb.profit);
+            return record;
+        }
+
+        // The single consumer, moves up to BATCH records out of the ring
+        size_t drain(std::vector<LogRecord>& batch) {
+            batch.clear();
+            while (batch.size() < BATCH) {
+                Slot& slot = slots_[tail_ & (CAPACITY - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+                    break;
+                }
+                batch.push_back(slot.record);
+                slot.sequence.store(tail_ + CAPACITY, std::memory_order_release);
+                tail_++;
+            }
+            return batch.size();
+        }
+
+        void drainLoop() {
+            std::vector<LogRecord> batch;
+            batch.reserve(BATCH);
+
+            while (true) {
+                // read before draining, so nothing written before a stop is left behind
+                bool stopping = !running_.load(std::memory_order_acquire);
+
+                if (drain(batch) > 0) {
+                    for (const auto& record : batch) {
+                        store(record);
+                    }
+                    continue;
+                }
+
+                for (auto& file : files_) {
+                    if (file.handle) {
+                        std::fflush(file.handle);
+                    }
+                }
+                flushed_.store(tail_, std::memory_order_release);
+
+                if (stopping) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        void store(const LogRecord& record) {
+            File& file = files_[logOf(record.kind)];
+            uint64_t day = record.timestamp / NS_PER_DAY;
+
+            if (!file.handle || file.day != day) {
+                if (file.handle) {
+                    std::fclose(file.handle);
+                }
+                file.handle = std::fopen(pathFor(logOf(record.kind), record.timestamp).c_str(), "ab");
+                file.day = day;
+                if (!file.handle) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                std::fseek(file.handle, 0, SEEK_END);
+                if (std::ftell(file.handle) == 0) {
+                    const unsigned char size = sizeof(LogRecord);
+                    std::fwrite(MAGIC, 1, sizeof(MAGIC), file.handle);
+                    std::fwrite(&size, 1, 1, file.handle);
+                }
+                file.named.assign(MAX_TOKENS, false);
+            }
+            if (hasPair(record.kind)) {
+                name(file, record.base, record.timestamp);
+                name(file, record.quote, record.timestamp);
+            }
+            std::fwrite(&record, sizeof(record), 1, file.handle);
+        }
+
+        // Writes a TOKEN record for the token unless the file has one already
+        void name(File& file, uint16_t token, uint64_t timestamp) {
+            if (token >= file.named.size() || file.named[token]) {
+                return;
+            }
+            file.named[token] = true;
+            const std::string* symbol = TokenTable::shared().name(static_cast<Token>(token));
+            if (!symbol) {
+                return;
+            }
+
+            LogRecord record{};
+            record.timestamp = timestamp;
+            record.kind = LogRecord::Kind::TOKEN;
+            record.base = token;
+            record.reserved = static_cast<uint8_t>(std::min(symbol->size(), sizeof(record.values)));
+            std::memcpy(record.values, symbol->data(), record.reserved);
+            std::fwrite(&record, sizeof(record), 1, file.handle);
+        }
+};
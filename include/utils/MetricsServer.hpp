@@ -0,0 +1,162 @@
+#pragma once
+
+#include "utils/Prometheus.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/**
+* @brief Serves GET /metrics on a loopback port from one background thread.
+* Each scrape calls render with a stream to write the Prometheus text into;
+* render runs on the server thread, so whatever it reads has to be safe to
+* read while the bot is running. One scrape is answered at a time and every
+* connection is closed after its answer.
+*/
+class MetricsServer {
+    public:
+        using Render = std::function<void(std::ostream&)>;
+
+        // Listens on 127.0.0.1:port, port 0 takes any free one. Throws when
+        // the port cannot be bound.
+        MetricsServer(uint16_t port, Render render) : render_(std::move(render)) {
+            listen_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            ::setsockopt(listen_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(port);
+            if (listen_ < 0 || ::bind(listen_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(listen_, 16) != 0) {
+                if (listen_ >= 0) {
+                    ::close(listen_);
+                }
+                throw std::runtime_error("MetricsServer: cannot listen on 127.0.0.1:" + std::to_string(port));
+            }
+
+            socklen_t len = sizeof(addr);
+            ::getsockname(listen_, reinterpret_cast<sockaddr*>(&addr), &len);
+            port_ = ntohs(addr.sin_port);
+
+            running_ = true;
+            thread_ = std::thread(&MetricsServer::serve, this);
+        }
+
+        MetricsServer(const MetricsServer&) = delete;
+        MetricsServer& operator=(const MetricsServer&) = delete;
+
+        ~MetricsServer() {
+            stop();
+        }
+
+        uint16_t port() const { return port_; }
+
+        uint64_t scrapes() const { return scrapes_.load(std::memory_order_relaxed); }
+
+        void stop() {
+            running_ = false;
+            if (thread_.joinable()) {
+                thread_.join();
+            }
+            if (listen_ >= 0) {
+                ::close(listen_);
+                listen_ = -1;
+            }
+        }
+
+    private:
+        // How often the accept loop looks at running_
+        static constexpr int POLL_MS = 200;
+        // Bound on the request head, nothing past the request line is used
+        static constexpr size_t MAX_REQUEST = 4096;
+
+        Render render_;
+        int listen_ = -1;
+        uint16_t port_ = 0;
+        std::atomic<bool> running_{false};
+        std::atomic<uint64_t> scrapes_{0};
+        std::thread thread_;
+
+        void serve() {
+            while (running_) {
+                pollfd ready{listen_, POLLIN, 0};
+                if (::poll(&ready, 1, POLL_MS) <= 0) {
+                    continue;
+                }
+                int client = ::accept(listen_, nullptr, nullptr);
+                if (client < 0) {
+                    continue;
+                }
+
+                // a stalled client cannot hold the server for long
+                timeval timeout{1, 0};
+                ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+                answer(client);
+                ::close(client);
+            }
+        }
+
+        void answer(int client) {
+            std::string request;
+            char chunk[1024];
+            while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST) {
+                ssize_t n = ::recv(client, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    return;
+                }
+                request.append(chunk, static_cast<size_t>(n));
+            }
+
+            std::string_view line(request);
+            line = line.substr(0, line.find("\r\n"));
+            bool metrics = line.starts_with("GET /metrics ") || line.starts_with("GET /metrics?");
+
+            std::ostringstream body;
+            if (metrics) {
+                try {
+                    render_(body);
+                    scrapes_.fetch_add(1, std::memory_order_relaxed);
+                } catch (const std::exception& e) {
+                    std::cerr << "[ERROR] Rendering metrics failed: " << e.what() << std::endl;
+                    send(client, "500 Internal Server Error", "text/plain", "");
+                    return;
+                }
+                send(client, "200 OK", PrometheusText::CONTENT_TYPE, body.str());
+            } else {
+                send(client, "404 Not Found", "text/plain", "only /metrics is served\n");
+            }
+        }
+
+        static void send(int client, std::string_view status, std::string_view type, const std::string& body) {
+            std::string response = "HTTP/1.1 " + std::string(status) + "\r\n"
+                "Content-Type: " + std::string(type) + "\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body;
+
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    return;
+                }
+                sent += static_cast<size_t>(n);
+            }
+        }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "common/LatencyHistogram.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+* @brief Writes metrics in the Prometheus text exposition format (0.0.4).
+* A family() line has to come before the samples of its metric, and all of
+* a metric's samples have to follow one another.
+*/
+class PrometheusText {
+    public:
+        static constexpr const char* CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+        // Upper bounds of latency histogram buckets, in seconds
+        static constexpr std::array<double, 14> BUCKETS = {
+            0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+        };
+
+        explicit PrometheusText(std::ostream& out) : out_(out) {}
+
+        void family(std::string_view name, std::string_view type, std::string_view help) {
+            out_ << "# HELP " << name << " " << help << "\n"
+                 << "# TYPE " << name << " " << type << "\n";
+        }
+
+        void sample(std::string_view name, std::string_view labels, uint64_t value) {
+            writeName(name, labels);
+            out_ << value << "\n";
+        }
+
+        void sample(std::string_view name, std::string_view labels, double value) {
+            writeName(name, labels);
+            out_ << number(value) << "\n";
+        }
+
+        // Buckets, sum and count of a nanosecond histogram, in seconds
+        void histogram(std::string_view name, std::string_view labels, const LatencyHistogram::Snapshot& snapshot) {
+            const std::string bucket = std::string(name) + "_bucket";
+            const std::string prefix = labels.empty() ? "" : std::string(labels) + ",";
+            for (double bound : BUCKETS) {
+                sample(bucket, prefix + "le=\"" + number(bound) + "\"",
+                    snapshot.countAtOrBelow(static_cast<uint64_t>(bound * 1e9)));
+            }
+            sample(bucket, prefix + "le=\"+Inf\"", snapshot.count());
+            sample(std::string(name) + "_sum", labels, static_cast<double>(snapshot.sum()) / 1e9);
+            sample(std::string(name) + "_count", labels, snapshot.count());
+        }
+
+        // name="value", the value escaped
+        static std::string label(std::string_view name, std::string_view value) {
+            std::string text(name);
+            text += "=\"";
+            for (char c : value) {
+                if (c == '\\' || c == '"') {
+                    text += '\\';
+                    text += c;
+                } else if (c == '\n') {
+                    text += "\\n";
+                } else {
+                    text += c;
+                }
+            }
+            return text + "\"";
+        }
+
+    private:
+        std::ostream& out_;
+
+        void writeName(std::string_view name, std::string_view labels) {
+            out_ << name;
+            if (!labels.empty()) {
+                out_ << "{" << labels << "}";
+            }
+            out_ << " ";
+        }
+
+        // Nine significant digits, plain decimals where they fit: 0.0005 not 5e-04
+        static std::string number(double value) {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.9g", value);
+            return text;
+        }
+};
@@ -1,11 +1,30 @@
 #include "common/Arber.hpp"
+#include "common/FixedPoint.hpp"
 #include "common/Gateway.hpp"
 #include "common/Instrument.hpp"
+#include "common/InstrumentUniverse.hpp"
+#include "common/MarketSnapshot.hpp"
+#include "common/ScanScheduler.hpp"
+#include "common/OpportunityTrace.hpp"
 #include "observer.hpp"
 #include "risk/risk.hpp"
 #include "decorator.hpp"
+#include "utils/Prometheus.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iostream>
 #include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <sstream>
 #include <vector>
 #include <thread>
 #include <chrono>
@@ -17,71 +36,235 @@ class ArbitrageBot {
         double maxTradeAmount;
         double minProfit;
 
-        bool running;
+        std::atomic<bool> running;
+
+        // Startup to first scan where every venue answered
+        std::chrono::steady_clock::time_point startedAt;
+        std::atomic<bool> firstValidScanReported;
+
+        // Quotes older than this at snapshot time take no part in a scan
+        std::chrono::milliseconds maxQuoteAge;
+        // How long a scan waits on the venues before going on without the slow ones
+        std::chrono::milliseconds scanDeadline;
+        // Venues with fresh quotes after which a scan stops waiting, 0 waits for all
+        size_t scanQuorum;
 
         ArbLogDecorator logger;
         ArbLatencyDecorator latencyMonitor;
+        // Read by the metrics endpoint while scans run
+        std::atomic<uint64_t> opportunitiesFound{0};
+        std::atomic<uint64_t> opportunitiesNotified{0};
+        std::array<std::atomic<uint64_t>, EXCHANGE_COUNT> deadlineMisses{};
+
+        // quote to observer stamps of the latest opportunities
+        TraceRecorder traces;
+
+        // scan latency as of the previous dumpLatency
+        LatencyHistogram::Snapshot lastScanDump;
+        std::mutex latencyDumpMutex;
 
         std::vector<std::unique_ptr<IObserver>> observers;
+        // scan workers dispatch one at a time as observers are not thread
+        // safe, it also guards currentMetrics against the risk thread
+        std::mutex dispatchMutex;
 
         RiskManager riskManager;
         RiskMetrics currentMetrics;
 
+        // Every venue's quote for every pair, each venue asked once per scan
+        // and with one bulk request where it has one, see Gateway::getBBOs.
+        // All venues are asked at once; the scan waits for them only up to
+        // scanDeadline, or until scanQuorum of them came back with fresh quotes
+        // for every pair, and goes on with whoever answered.
+        MarketSnapshot takeSnapshot(std::span<const Instrument> instruments) {
+            // late venues keep reading the pairs after this returns
+            auto pairs = std::make_shared<const std::vector<Instrument>>(instruments.begin(), instruments.end());
+
+            std::vector<Task<std::vector<BBO>>> fetches;
+            std::vector<Exchange> venues;
+            fetches.reserve(gws.size());
+            venues.reserve(gws.size());
+            for (Gateway* gw : gws) {
+                fetches.push_back(gw->getBBOsAsync(*pairs));
+                venues.push_back(gw->name);
+            }
+
+            // runs on the venues' threads and may outlive this scan, so it
+            // holds nothing of the bot
+            auto freshQuotes = [maxAge = static_cast<uint64_t>(maxQuoteAge.count())](const std::vector<BBO>& bbos) {
+                const uint64_t now = MarketSnapshot::nowMs();
+                return std::all_of(bbos.begin(), bbos.end(), [&](const BBO& bbo) {
+                    return bbo.timestamp != 0 && bbo.timestamp + maxAge >= now;
+                });
+            };
+            const auto deadline = std::chrono::steady_clock::now() + scanDeadline;
+            auto arrived = sync_wait_until(std::move(fetches), deadline, pairs, scanQuorum,
+                std::function<bool(const std::vector<BBO>&)>(freshQuotes));
+            const bool timedOut = std::chrono::steady_clock::now() >= deadline;
+
+            std::vector<std::vector<BBO>> quotes;
+            std::vector<bool> missed(gws.size(), false);
+            quotes.reserve(gws.size());
+            for (size_t v = 0; v < gws.size(); v++) {
+                if (arrived[v]) {
+                    quotes.push_back(std::move(*arrived[v]));
+                    continue;
+                }
+                quotes.emplace_back(instruments.size());
+                missed[v] = true;
+                // left behind by a quorum is not a miss, the deadline had not passed
+                if (timedOut) {
+                    std::cerr << "[ERROR] " << venues[v] << " missed the " << scanDeadline.count()
+                              << "ms scan deadline" << std::endl;
+                    deadlineMisses[static_cast<size_t>(venues[v])].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            return MarketSnapshot(std::move(venues), instruments, quotes, MarketSnapshot::nowMs(), std::move(missed));
+        }
+
+        // What one scan saw, besides its best pairing per pair
+        struct ScanResult {
+            std::vector<Arber> opportunities;
+            // best sell bid over buy ask across venues per pair in %, crossed
+            // or not, NaN for pairs without two fresh quotes
+            std::vector<double> edges;
+            // every venue had a fresh quote for every pair
+            bool complete = true;
+        };
+
         Arber findArbitrage(Token buyToken, Token sellToken) {
+            const Instrument instrument(buyToken, sellToken, Exchange::BINANCE, FeedType::SPOT);
+            return findArbitrage(std::span<const Instrument>(&instrument, 1)).front();
+        }
+
+        std::vector<Arber> findArbitrage(std::span<const Instrument> instruments) {
+            return scanPairs(instruments).opportunities;
+        }
+
+        ScanResult scanPairs(std::span<const Instrument> instruments) {
+            const MarketSnapshot snapshot = takeSnapshot(instruments);
+            const uint64_t assembled = traceNow();
+
+            ScanResult result;
+            result.opportunities.reserve(snapshot.pairs());
+            result.edges.reserve(snapshot.pairs());
+            for (size_t pair = 0; pair < snapshot.pairs(); pair++) {
+                result.opportunities.push_back(bestOf(snapshot, pair, result));
+                result.opportunities.back().assembledAt = assembled;
+                result.opportunities.back().evaluatedAt = traceNow();
+                if (result.opportunities.back().getExecute()) {
+                    opportunitiesFound.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            return result;
+        }
+
+        // Best buy low / sell high pairing across the venues of one snapshot,
+        // legs older than maxQuoteAge are left out. Adds the pair's edge and
+        // completeness to result.
+        Arber bestOf(const MarketSnapshot& snapshot, size_t pair, ScanResult& result) {
+            const Token buyToken = snapshot.instrument(pair).baseSymbol;
+            const Token sellToken = snapshot.instrument(pair).quoteSymbol;
             Arber bestArb(buyToken, sellToken, Exchange::BINANCE, Exchange::BINANCE, 0, 0, BBO(), BBO(), false);
+            const PairScale scale = scaleOf(buyToken, sellToken);
+            double edge = std::nan("");
 
-            for (Gateway* buyExGw : gws) {
-                BBO buyBBO = buyExGw->getBBO(buyToken, sellToken);
+            for (size_t buy = 0; buy < snapshot.venues(); buy++) {
+                // a failed fetch comes back as an empty BBO, which is never fresh
+                bool buyFresh = snapshot.fresh(buy, pair, maxQuoteAge);
+                result.complete = result.complete && buyFresh;
+                if (!buyFresh) continue;
 
-                for (Gateway* sellExGw : gws) {
-                    if (buyExGw == sellExGw) continue;
+                for (size_t sell = 0; sell < snapshot.venues(); sell++) {
+                    if (buy == sell || !snapshot.fresh(sell, pair, maxQuoteAge)) continue;
 
-                    BBO sellBBO = sellExGw->getBBO(buyToken, sellToken);
+                    const BBO& buyBBO = snapshot.quote(buy, pair);
+                    const BBO& sellBBO = snapshot.quote(sell, pair);
 
-                    double profit = (sellBBO.bid.price - buyBBO.ask.price) / buyBBO.ask.price * 100;
+                    // spread is exact in ticks, only the ratio goes to floating point
+                    int64_t spread = sellBBO.bid.price - buyBBO.ask.price;
+                    double profit = static_cast<double>(spread) / static_cast<double>(buyBBO.ask.price) * 100;
+                    edge = std::isnan(edge) ? profit : std::max(edge, profit);
 
                     // if (profit > minProfit && profit > bestArb.profit) {
-                    if (sellBBO.bid.price > buyBBO.ask.price) {
+                    if (spread > 0) {
                         double amount = std::min({
-                            buyBBO.ask.size * buyBBO.ask.price,
-                            sellBBO.bid.size * sellBBO.bid.price
+                            scale.notional(buyBBO.ask),
+                            scale.notional(sellBBO.bid)
                         });
 
                         bestArb = Arber(
                             buyToken,
                             sellToken,
-                            buyExGw->name,
-                            sellExGw->name,
+                            snapshot.venue(buy),
+                            snapshot.venue(sell),
                             profit,
                             amount,
                             buyBBO,
                             sellBBO,
                             true
                         );
-
-                        // set the risk calculator accordingly to use this
-                        // if (bestArb.getExecute()) {
-                            // if (!riskManager.validateArbitrage(bestArb)) {
-                                // bestArb = Arber(
-                                //     bestArb.buyExchange,
-                                //     bestArb.sellExchange,
-                                //     bestArb.profit,
-                                //     bestArb.amount,
-                                //     bestArb.buyBBO,
-                                //     bestArb.sellBBO,
-                                //     true  // Set execute to false if risk check fails
-                                // );
-                                // logger.logRiskCheckFailed(bestArb);
-                            // }
-                        // }
+                        // risk is checked once per opportunity, see dispatch
                     }
                 }
             }
 
+            result.edges.push_back(edge);
             return bestArb;
         }
 
+        // Log and observers for a found opportunity, traced from its quotes'
+        // arrival to the observers. The risk stage is stamped where the check
+        // belongs, riskManager is not consulted yet.
+        void dispatch(const Arber& opportunity) {
+            std::lock_guard<std::mutex> lock(dispatchMutex);
+            // set the risk calculator accordingly before validating here
+            // if (!riskManager.validateArbitrage(opportunity)) {
+            //     logger.logRiskCheckFailed(opportunity);
+            // }
+            const uint64_t riskChecked = traceNow();
+
+            logger.logOpportunity(opportunity);
+            notifyObservers(opportunity);
+            traces.record(OpportunityTrace::of(opportunity, riskChecked, traceNow()));
+        }
+
+        // One worker of run: takes batches until stopped, one every scanInterval ms
+        void work(ScanScheduler& scheduler, int scanInterval) {
+            while (running) {
+                ScanScheduler::Batch batch = scheduler.next();
+                if (batch.pairs.empty()) {
+                    scheduler.done(batch, {});
+                } else {
+                    auto start_time = latencyMonitor.start();
+
+                    const std::vector<Instrument> instruments = scheduler.instruments(batch);
+                    ScanResult result = scanPairs(instruments);
+                    scheduler.done(batch, result.edges);
+
+                    if (result.complete && !firstValidScanReported.exchange(true)) {
+                        auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - startedAt);
+                        std::cout << "[INFO] First valid scan " << took.count() << "ms after startup" << std::endl;
+                    }
+
+                    for (const Arber& opportunity : result.opportunities) {
+                        if (opportunity.getExecute()) {
+                            dispatch(opportunity);
+                        }
+                    }
+
+                    latencyMonitor.end(start_time);
+                }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(scanInterval));
+            }
+        }
+
         void notifyObservers(const Arber& opportunity) {
+            if (!observers.empty()) {
+                opportunitiesNotified.fetch_add(1, std::memory_order_relaxed);
+            }
             for (const auto& observer : observers) {
                 observer->onArbitrageOpportunity(opportunity);
             }
@@ -89,7 +272,10 @@ class ArbitrageBot {
 
     public:
         ArbitrageBot(double minProfit, double maxTradeAmount)
-            : minProfit(minProfit), maxTradeAmount(maxTradeAmount), running(true) {
+            : minProfit(minProfit), maxTradeAmount(maxTradeAmount), running(true),
+              startedAt(std::chrono::steady_clock::now()),
+              firstValidScanReported(false), maxQuoteAge(std::chrono::milliseconds(2000)),
+              scanDeadline(std::chrono::milliseconds(500)), scanQuorum(2) {
             // Initialize risk strategies
             riskManager.addStrategy(new MaxExposureStrategy(100000)); // $100k max exposure
             riskManager.addStrategy(new DrawdownStrategy(0.05));      // 5% max drawdown
@@ -110,37 +296,224 @@ class ArbitrageBot {
         }
 
         void updateRiskMetrics(const RiskMetrics& metrics) {
+            std::lock_guard<std::mutex> lock(dispatchMutex);
             currentMetrics = metrics;
             riskManager.updateMetrics(metrics);
         }
 
+        void setMaxQuoteAge(std::chrono::milliseconds age) {
+            maxQuoteAge = age;
+        }
+
+        void setScanDeadline(std::chrono::milliseconds deadline) {
+            scanDeadline = deadline;
+        }
+
+        void setScanQuorum(size_t venues) {
+            scanQuorum = venues;
+        }
+
         void addExchange(Gateway* gw) {
             gws.push_back(gw);
         }
 
+        // Stream the pair from every venue that has a feed, the scan then reads
+        // quotes from memory and only goes to REST while a stream is down
+        void subscribe(Token buyToken, Token sellToken) {
+            for (auto* gw : gws) {
+                gw->subscribe(buyToken, sellToken);
+            }
+        }
+
+        // Every venue's spot listings, read from cachePath while it is younger
+        // than maxAge and otherwise fetched from all venues at once and cached
+        // again. Pairs trading on two venues or more get their tickers and
+        // scales registered and are returned, ready to scan.
+        std::vector<Instrument> loadUniverse(const std::string& cachePath,
+                                             std::chrono::hours maxAge = std::chrono::hours(24)) {
+            auto start = std::chrono::steady_clock::now();
+            InstrumentUniverse universe;
+
+            std::error_code error;
+            auto written = std::filesystem::last_write_time(cachePath, error);
+            bool fresh = !error && std::filesystem::file_time_type::clock::now() - written < maxAge;
+            if (!fresh || !universe.load(cachePath) || universe.empty()) {
+                universe = InstrumentUniverse();
+                std::vector<std::future<std::vector<Listing>>> fetching;
+                for (auto* gw : gws) {
+                    fetching.push_back(std::async(std::launch::async, [gw]() { return gw->listings(); }));
+                }
+                for (size_t i = 0; i < gws.size(); i++) {
+                    auto listings = fetching[i].get();
+                    std::cout << "[INFO] " << gws[i]->name << " lists " << listings.size() << " spot instruments" << std::endl;
+                    universe.add(std::move(listings));
+                }
+                if (!universe.empty()) {
+                    universe.save(cachePath);
+                }
+            }
+
+            std::vector<Exchange> venues;
+            for (auto* gw : gws) {
+                venues.push_back(gw->name);
+            }
+            std::vector<Instrument> pairs = universe.scannable(venues);
+            universe.apply(pairs);
+
+            auto took = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            std::cout << "[INFO] " << universe.size() << " listings, " << pairs.size()
+                      << " pairs on two venues or more, loaded in " << took.count() << "ms" << std::endl;
+            return pairs;
+        }
+
+        // Warm every venue's connections in parallel before scanning starts
+        void prewarm() {
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<std::future<size_t>> warming;
+            for (auto* gw : gws) {
+                warming.push_back(std::async(std::launch::async, [gw]() { return gw->prewarm(); }));
+            }
+
+            for (size_t i = 0; i < gws.size(); i++) {
+                size_t warmed = warming[i].get();
+                std::cout << "[INFO] " << gws[i]->name << " prewarmed " << warmed << " connections" << std::endl;
+            }
+
+            auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+            std::cout << "[INFO] Prewarm took " << took.count() << "ms" << std::endl;
+        }
+
+        // Per venue, endpoint and phase latency plus whole scans, for what
+        // happened since the previous call. Safe to call while running.
+        void dumpLatency(std::ostream& out) {
+            std::lock_guard<std::mutex> lock(latencyDumpMutex);
+            LatencyRecorder::writeHeader(out);
+            for (auto* gw : gws) {
+                std::ostringstream venue;
+                venue << gw->name;
+                gw->latency().dump(out, venue.str());
+            }
+
+            auto scans = latencyMonitor.histogram().snapshot();
+            auto interval = scans.since(lastScanDump);
+            lastScanDump = std::move(scans);
+            if (interval.count() > 0) {
+                LatencyRecorder::writeRow(out, "bot", "scan", interval);
+            }
+            out << std::flush;
+        }
+
+        // Scans, opportunities and every venue's requests in the Prometheus
+        // text format. Only reads atomics, so a scrape never waits on a scan;
+        // exchanges have to be added before the first call.
+        void writeMetrics(std::ostream& out) {
+            PrometheusText metrics(out);
+
+            metrics.family("cexa_scan_duration_seconds", "histogram", "Wall time of a whole scan, its count gives the scan rate");
+            metrics.histogram("cexa_scan_duration_seconds", "", latencyMonitor.histogram().snapshot());
+
+            metrics.family("cexa_opportunities_found_total", "counter", "Pairs where a scan found a profitable spread");
+            metrics.sample("cexa_opportunities_found_total", "", opportunitiesFound.load(std::memory_order_relaxed));
+            metrics.family("cexa_opportunities_notified_total", "counter", "Opportunities handed to the observers");
+            metrics.sample("cexa_opportunities_notified_total", "", opportunitiesNotified.load(std::memory_order_relaxed));
+
+            std::vector<std::string> venues;
+            std::vector<AsyncHttp::LoadStats> loads;
+            for (auto* gw : gws) {
+                venues.push_back(PrometheusText::label("venue", EnumTraits<Exchange>::toString(gw->name)));
+                loads.push_back(gw->httpLoad());
+            }
+
+            metrics.family("cexa_scan_deadline_misses_total", "counter", "Scans that went on without the venue");
+            for (size_t v = 0; v < gws.size(); v++) {
+                metrics.sample("cexa_scan_deadline_misses_total", venues[v],
+                    deadlineMisses[static_cast<size_t>(gws[v]->name)].load(std::memory_order_relaxed));
+            }
+
+            metrics.family("cexa_http_requests_total", "counter", "Requests answered, failures included");
+            for (size_t v = 0; v < gws.size(); v++) {
+                metrics.sample("cexa_http_requests_total", venues[v], loads[v].completed);
+            }
+            metrics.family("cexa_http_request_errors_total", "counter", "Requests without an HTTP answer or with a status of 400 and up");
+            for (size_t v = 0; v < gws.size(); v++) {
+                metrics.sample("cexa_http_request_errors_total", venues[v], loads[v].failed);
+            }
+            metrics.family("cexa_http_queue_depth", "gauge", "Requests waiting for a connection or rate limit budget");
+            for (size_t v = 0; v < gws.size(); v++) {
+                metrics.sample("cexa_http_queue_depth", venues[v], static_cast<uint64_t>(loads[v].queued));
+            }
+            metrics.family("cexa_http_connections_busy", "gauge", "Pooled connections in use");
+            for (size_t v = 0; v < gws.size(); v++) {
+                metrics.sample("cexa_http_connections_busy", venues[v], static_cast<uint64_t>(loads[v].busy));
+            }
+            metrics.family("cexa_http_connections", "gauge", "Size of the connection pool");
+            for (size_t v = 0; v < gws.size(); v++) {
+                metrics.sample("cexa_http_connections", venues[v], static_cast<uint64_t>(loads[v].pool_size));
+            }
+
+            metrics.family("cexa_http_request_duration_seconds", "histogram", "Queue wait plus transfer of a request, by endpoint");
+            for (size_t v = 0; v < gws.size(); v++) {
+                gws[v]->latency().forEach([&](const EndpointLatency& endpoint) {
+                    metrics.histogram("cexa_http_request_duration_seconds",
+                        venues[v] + "," + PrometheusText::label("endpoint", endpoint.endpoint()),
+                        endpoint.histogram(EndpointLatency::Phase::TOTAL).snapshot());
+                });
+            }
+
+            metrics.family("cexa_http_untracked_requests_total", "counter", "Requests whose endpoint found no room in the latency table");
+            for (size_t v = 0; v < gws.size(); v++) {
+                metrics.sample("cexa_http_untracked_requests_total", venues[v], gws[v]->latency().untracked());
+            }
+
+            metrics.family("cexa_log_records_dropped_total", "counter", "Log records lost to a full logger ring");
+            metrics.sample("cexa_log_records_dropped_total", "", AsyncLogger::shared().dropped());
+        }
+
+        // The latest opportunities stage by stage, as Chrome trace event JSON
+        // for chrome://tracing or Perfetto. Safe to call while running.
+        void exportTraces(std::ostream& out) const {
+            traces.writeChromeTrace(out);
+        }
+
+        const TraceRecorder& opportunityTraces() const { return traces; }
+
+        // Ends run() and its scan workers, they finish the scan in hand first
         void stop() {
             running = false;
+        }
+
+        // Tears the venues' clients down. Only once run() has returned and
+        // nothing else calls into the bot, a scan still going would submit
+        // to a client being destroyed.
+        void shutdown() {
             for (auto* gw : gws) {
                 gw->destroy();
             }
         }
 
         void run(Token buyToken, Token sellToken, int scanInterval = 1000) {
-            std::cout << "Starting arbitrage scanner..." << std::endl;
-
-            while (running) {
-                auto start_time = latencyMonitor.start();
-
-                Arber opportunity = findArbitrage(buyToken, sellToken);
-
-                if (opportunity.getExecute()) {
-                    logger.logOpportunity(opportunity);
-                    notifyObservers(opportunity);
-                }
+            run({Instrument(buyToken, sellToken, Exchange::BINANCE, FeedType::SPOT)}, scanInterval);
+        }
 
-                latencyMonitor.end(start_time);
+        // Scans the pairs on workers threads sharing the gateways and their
+        // pools. Every pair fits in the hot set of a default scheduler up to
+        // ScanScheduler::Config::hotPairs, past that the busiest pairs are
+        // scanned every round and the rest take turns, see ScanScheduler.
+        void run(std::vector<Instrument> instruments, int scanInterval = 1000, size_t workers = 1,
+                 ScanScheduler::Config config = {}) {
+            std::cout << "Starting arbitrage scanner on " << instruments.size() << " pairs, "
+                      << workers << " workers..." << std::endl;
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(scanInterval));
+            ScanScheduler scheduler(std::move(instruments), config);
+            std::vector<std::thread> pool;
+            for (size_t w = 1; w < workers; w++) {
+                pool.emplace_back([this, &scheduler, scanInterval]() { work(scheduler, scanInterval); });
+            }
+            work(scheduler, scanInterval);
+            for (auto& worker : pool) {
+                worker.join();
             }
         }
 
@@ -148,6 +521,10 @@ class ArbitrageBot {
             return findArbitrage(buyToken, sellToken);
         }
 
+        std::vector<Arber> scan(std::span<const Instrument> instruments) {
+            return findArbitrage(instruments);
+        }
+
         ~ArbitrageBot() {
             // TODO: Bad Each gw should be handles indiviual
         }
@@ -1,76 +1,160 @@
 #include "common/Gateway.hpp"
 #include "common/Instrument.hpp"
 #include "common/AsyncHttp.hpp"
+#include "common/DepthParser.hpp"
 
 #include <cstdint>
 #include <exception>
+#include <stdexcept>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <chrono>
-#include <sstream>
+#include <span>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+// ticker channel carries best bid and ask with every trade and book change
+class CoinbaseStreamProtocol : public StreamProtocol {
+    public:
+        std::string subscribeMessage(const std::string& ticker) override {
+            return json{
+                {"type", "subscribe"},
+                {"product_ids", {ticker}},
+                {"channels", {"ticker"}}
+            }.dump();
+        }
+
+        bool parse(std::string_view frame, std::string_view& ticker, WireQuote& quote) override {
+            std::string_view type;
+            if (!DepthParser::string(frame, "type", type) || type != "ticker") {
+                return false;
+            }
+
+            if (!DepthParser::string(frame, "product_id", ticker) ||
+                !DepthParser::decimal(frame, "best_bid", quote.bidPrice) ||
+                !DepthParser::decimal(frame, "best_bid_size", quote.bidSize) ||
+                !DepthParser::decimal(frame, "best_ask", quote.askPrice) ||
+                !DepthParser::decimal(frame, "best_ask_size", quote.askSize)) {
+                throw std::runtime_error("malformed ticker frame");
+            }
+            return true;
+        }
+};
+
 class CoinbaseGateway : public Gateway {
     public:
-        CoinbaseGateway(std::string url = "https://api.exchange.coinbuyToken.com/products") {
+        CoinbaseGateway(std::string url = "https://api.exchange.coinbuyToken.com/products",
+                    std::string streamUrl = "wss://ws-feed.exchange.coinbase.com") {
             this->url = url;
+            this->streamUrl = streamUrl;
             this->name = Exchange::COINBASE;
+
+            // public endpoints allow 10 requests per second per IP
+            limitRate({8, std::chrono::seconds(1), ""});
         }
 
         std::string getTicker(Token& buyToken, Token& sellToken) override {
-            std::stringstream ss;
             if (buyToken == Token::USDC || buyToken == Token::USDT) {
-                ss << "USD-" << sellToken ;
+                return "USD-" + EnumTraits<Token>::toString(sellToken);
             } else if (sellToken == Token::USDC || sellToken == Token::USDT) {
-                ss << buyToken <<"-USD";
+                return EnumTraits<Token>::toString(buyToken) + "-USD";
             } else {
-                ss << buyToken << "-" << sellToken;
+                return EnumTraits<Token>::toString(buyToken) + "-" + EnumTraits<Token>::toString(sellToken);
+            }
+        }
+
+        std::vector<Listing> listings() override {
+            return fetchListings(this->url, 1, parseListings);
+        }
+
+        // Products of a /products answer. USDC books were folded into USD, so
+        // USD products stand for the USDC pair, as getTicker has it.
+        static std::vector<Listing> parseListings(std::string_view body) {
+            TokenTable& tokens = TokenTable::shared();
+            const json products = json::parse(body);
+            std::vector<Listing> listings;
+            listings.reserve(products.size());
+
+            for (const auto& product : products) {
+                std::string quote = product.at("quote_currency").get<std::string>();
+                bool trading = product.at("status") == "online" && !product.value("trading_disabled", false);
+                listings.push_back(Listing{Exchange::COINBASE,
+                    tokens.intern(product.at("base_currency").get<std::string>()),
+                    quote == "USD" ? Token::USDC : tokens.intern(quote),
+                    product.at("id").get<std::string>(),
+                    product.at("quote_increment").get<std::string>(),
+                    product.at("base_increment").get<std::string>(),
+                    trading ? ListingStatus::TRADING : ListingStatus::HALTED});
             }
-            return ss.str();
+            return listings;
+        }
+
+        std::unique_ptr<StreamProtocol> streamProtocol() override {
+            return std::make_unique<CoinbaseStreamProtocol>();
         }
 
         BBO getBBO(Token buyToken, Token sellToken) override {
-            try {
-                auto& http = getHttp();
+            // Served from memory while the stream is live
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                return *bbo;
+            }
+            return sync_wait(CoinbaseGateway::getBBOAsync(buyToken, sellToken));
+        }
 
-                const std::string depthsUrl = this->url + "/" + getTicker(buyToken, sellToken) + "/book";
-                std::map<std::string, std::string> headers = {
-                    {"Accept", "application/json"}
-                };
+        // The Exchange API has no bulk ticker endpoint, so getBBOs fans out
+        // one book request per pair
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            return fanOut(instruments, [this](Token base, Token quote) {
+                return CoinbaseGateway::getBBOAsync(base, quote);
+            });
+        }
 
-                auto response_future = http.get_raw(depthsUrl, headers);
-                auto res = response_future.get();
+        Task<BBO> getBBOAsync(Token buyToken, Token sellToken) override {
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                co_return *bbo;
+            }
+
+            try {
+                // URL, headers and options are built once per pair
+                const auto& depthRequest = preparedFor(buyToken, sellToken, [&]() {
+                    return AsyncHttp::prepare_get(this->url + "/" + symbol(buyToken, sellToken) + "/book",
+                        {{"Accept", "application/json"}}, depthOptions());
+                });
+
+                auto res = co_await getHttp().co_fire(depthRequest);
 
                 if (res.status_code != 200) {
                     std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << res.body << std::endl;
-                    return BBO();
+                    co_return BBO();
                 }
 
-                json data = json::parse(res.body);
                 BBO bbo;
-
-                double bidPrice = std::stod(data["bids"][0][0].get<std::string>());
-                double bidSize = std::stod(data["bids"][0][1].get<std::string>());
-
-                double askPrice = std::stod(data["asks"][0][0].get<std::string>());
-                double askSize = std::stod(data["asks"][0][1].get<std::string>());
-
-                bbo.bid = PriceLevel{bidPrice, bidSize};
-                bbo.ask = PriceLevel{askPrice, askSize};
+                if (!timedParse(res, [&]() { return parseDepth(res.body, scaleOf(buyToken, sellToken), bbo); })) {
+                    std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: unreadable depth payload" << std::endl;
+                    co_return BBO();
+                }
 
                 auto now = std::chrono::system_clock::now();
                 bbo.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
                     now.time_since_epoch()
                 ).count();
+                stampQuote(bbo, res, false);
 
-                return bbo;
+                co_return bbo;
 
             } catch(const std::exception& e) {
                 std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << e.what() << std::endl;
-                return BBO();
+                co_return BBO();
             }
         }
 
+        // Top of a level 1 book response, which carries no timestamp of its own
+        static bool parseDepth(std::string_view body, PairScale scale, BBO& bbo) {
+            return DepthParser::top(body, "bids", scale, bbo.bid) &&
+                DepthParser::top(body, "asks", scale, bbo.ask);
+        }
 };
@@ -1,77 +1,438 @@
 #include "common/Gateway.hpp"
 #include "common/Instrument.hpp"
 #include "common/AsyncHttp.hpp"
+#include "common/DepthParser.hpp"
+#include "common/OrderBook.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <cstdint>
 #include <exception>
+#include <functional>
+#include <stdexcept>
 #include <iostream>
+#include <memory>
 #include <map>
+#include <mutex>
+#include <set>
 #include <vector>
 #include <chrono>
-#include <sstream>
 #include <string>
+#include <span>
+#include <string_view>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
 struct BinanceDepths {
     uint64_t lastUpdateId;
-    std::vector<std::pair<std::string, std::string> > bids;
-    std::vector<std::pair<std::string, std::string> > asks;
+    std::vector<PriceLevel> bids;
+    std::vector<PriceLevel> asks;
+};
+
+// One depthUpdate event, updates firstUpdateId (U) to finalUpdateId (u)
+struct BinanceDiff {
+    uint64_t firstUpdateId;
+    uint64_t finalUpdateId;
+    std::vector<PriceLevel> bids;
+    std::vector<PriceLevel> asks;
+};
+
+// bookTicker pushes every change to the top of book. With a depth handler
+// the diff depth stream rides the same connection and its frames go there.
+class BinanceStreamProtocol : public StreamProtocol {
+    public:
+        using DepthHandler = std::function<void(std::string_view)>;
+
+        explicit BinanceStreamProtocol(DepthHandler onDepth = {}) : onDepth_(std::move(onDepth)) {}
+
+        std::string subscribeMessage(const std::string& ticker) override {
+            std::string stream = ticker;
+            std::transform(stream.begin(), stream.end(), stream.begin(),
+                [](unsigned char c) { return std::tolower(c); });
+
+            json params = {stream + "@bookTicker"};
+            if (onDepth_) {
+                params.push_back(stream + "@depth@100ms");
+            }
+            return json{
+                {"method", "SUBSCRIBE"},
+                {"params", params},
+                {"id", 1}
+            }.dump();
+        }
+
+        bool parse(std::string_view frame, std::string_view& ticker, WireQuote& quote) override {
+            std::string_view event;
+            if (onDepth_ && DepthParser::string(frame, "e", event) && event == "depthUpdate") {
+                onDepth_(frame);
+                return false;
+            }
+
+            // subscription acks carry no quote
+            if (!DepthParser::string(frame, "s", ticker)) {
+                return false;
+            }
+
+            if (!DepthParser::decimal(frame, "b", quote.bidPrice) || !DepthParser::decimal(frame, "B", quote.bidSize) ||
+                !DepthParser::decimal(frame, "a", quote.askPrice) || !DepthParser::decimal(frame, "A", quote.askSize)) {
+                throw std::runtime_error("malformed bookTicker");
+            }
+            return true;
+        }
+
+    private:
+        DepthHandler onDepth_;
 };
 
 class BinanceGateway : public Gateway {
     public:
-        BinanceGateway(std::string url = "https://api.binance.com/api/v3") {
+        BinanceGateway(std::string url = "https://api.binance.com/api/v3",
+                    std::string streamUrl = "wss://stream.binance.com:9443/ws") {
             this->url = url;
+            this->streamUrl = streamUrl;
             this->name = Exchange::BINANCE;
+
+            // 6000 weight per minute per IP, usage comes back on every response
+            limitRate({4800, std::chrono::minutes(1), "X-MBX-USED-WEIGHT-1M"});
+        }
+
+        // the stream and snapshot callbacks write the books
+        ~BinanceGateway() override {
+            quiesce();
         }
 
         std::string getTicker(Token& buyToken, Token& sellToken) override {
-            std::stringstream ss;
-            ss << buyToken << sellToken;
-            return ss.str();
+            return EnumTraits<Token>::toString(buyToken) + EnumTraits<Token>::toString(sellToken);
         }
 
-        BBO getBBO(Token buyToken, Token sellToken) override {
-            try {
-                auto& http = getHttp();
+        std::vector<Listing> listings() override {
+            // exchangeInfo for every symbol costs 20
+            return fetchListings(this->url + "/exchangeInfo", 20, parseListings);
+        }
 
-                const std::string depthsUrl = this->url + "/depth?symbol=" + getTicker(buyToken, sellToken);
-                std::map<std::string, std::string> headers = {
-                    {"Accept", "application/json"}
-                };
+        // Spot symbols of an /exchangeInfo answer, steps from PRICE_FILTER and LOT_SIZE
+        static std::vector<Listing> parseListings(std::string_view body) {
+            TokenTable& tokens = TokenTable::shared();
+            const json info = json::parse(body);
+            std::vector<Listing> listings;
+            listings.reserve(info.at("symbols").size());
 
-                auto response_future = http.get_raw(depthsUrl, headers);
-                auto res = response_future.get();
+            for (const auto& symbol : info.at("symbols")) {
+                if (!symbol.value("isSpotTradingAllowed", true)) {
+                    continue;
+                }
+                Listing listing{Exchange::BINANCE,
+                    tokens.intern(symbol.at("baseAsset").get<std::string>()),
+                    tokens.intern(symbol.at("quoteAsset").get<std::string>()),
+                    symbol.at("symbol").get<std::string>(), "", "",
+                    symbol.at("status") == "TRADING" ? ListingStatus::TRADING : ListingStatus::HALTED};
 
-                if (res.status_code != 200) {
-                    std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << res.body << std::endl;
-                    return BBO();
+                for (const auto& filter : symbol.value("filters", json::array())) {
+                    if (filter.at("filterType") == "PRICE_FILTER") {
+                        listing.tickSize = filter.at("tickSize").get<std::string>();
+                    } else if (filter.at("filterType") == "LOT_SIZE") {
+                        listing.lotSize = filter.at("stepSize").get<std::string>();
+                    }
                 }
+                listings.push_back(std::move(listing));
+            }
+            return listings;
+        }
 
-                json data = json::parse(res.body);
-                BBO bbo;
+        std::unique_ptr<StreamProtocol> streamProtocol() override {
+            return std::make_unique<BinanceStreamProtocol>([this](std::string_view frame) { onDepthUpdate(frame); });
+        }
+
+        // Streams the pair's depth diffs into its book as well as its top of book
+        void subscribe(Token buyToken, Token sellToken) override {
+            {
+                std::lock_guard<std::mutex> lock(booksMutex);
+                depthTickers.emplace(symbol(buyToken, sellToken), Instrument(buyToken, sellToken, name, FeedType::SPOT));
+            }
+            Gateway::subscribe(buyToken, sellToken);
+        }
+
+        BBO getBBO(Token buyToken, Token sellToken) override {
+            // Served from memory while the stream is live
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                return *bbo;
+            }
+            return sync_wait(BinanceGateway::getBBOAsync(buyToken, sellToken));
+        }
 
-                double bidPrice = std::stod(data["bids"][0][0].get<std::string>());
-                double bidSize = std::stod(data["bids"][0][1].get<std::string>());
+        Task<BBO> getBBOAsync(Token buyToken, Token sellToken) override {
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                co_return *bbo;
+            }
 
-                double askPrice = std::stod(data["asks"][0][0].get<std::string>());
-                double askSize = std::stod(data["asks"][0][1].get<std::string>());
+            try {
+                auto res = co_await getHttp().co_fire(depthRequest(buyToken, sellToken));
 
-                bbo.bid = PriceLevel{bidPrice, bidSize};
-                bbo.ask = PriceLevel{askPrice, askSize};
+                if (res.status_code != 200) {
+                    std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << res.body << std::endl;
+                    co_return BBO();
+                }
 
                 auto now = std::chrono::system_clock::now();
-                bbo.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                uint64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
                     now.time_since_epoch()
                 ).count();
 
-                return bbo;
+                BBO bbo;
+                if (!timedParse(res, [&]() { return applyDepths(buyToken, sellToken, res.body, timestamp, bbo); })) {
+                    std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: unreadable depth payload" << std::endl;
+                    co_return BBO();
+                }
+                // depth carries no time, the timestamp is ours
+                stampQuote(bbo, res, false);
+                co_return bbo;
 
             } catch(const std::exception& e) {
                 std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << e.what() << std::endl;
-                return BBO();
+                co_return BBO();
+            }
+        }
+
+        // One bookTicker request for every pair asked, weight 4 however many there are
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            return bulkBBOs(instruments,
+                [this](Token base, Token quote) { return BinanceGateway::getBBOAsync(base, quote); },
+                [this](std::span<const Instrument> pairs, std::vector<BBO>* bbos) { return fetchTickers(pairs, bbos); });
+        }
+
+        // Reads a /depth snapshot into depths, reusing its capacity
+        static bool parseDepths(std::string_view body, PairScale scale, BinanceDepths& depths) {
+            depths.bids.clear();
+            depths.asks.clear();
+            return DepthParser::integer(body, "lastUpdateId", depths.lastUpdateId) &&
+                DepthParser::levels(body, "bids", scale, [&](const PriceLevel& level) {
+                    depths.bids.push_back(level);
+                    return true;
+                }) &&
+                DepthParser::levels(body, "asks", scale, [&](const PriceLevel& level) {
+                    depths.asks.push_back(level);
+                    return true;
+                }) &&
+                !depths.bids.empty() && !depths.asks.empty();
+        }
+
+        // Reads a depthUpdate frame into diff, reusing its capacity
+        static bool parseDiff(std::string_view frame, PairScale scale, BinanceDiff& diff) {
+            diff.bids.clear();
+            diff.asks.clear();
+            return DepthParser::integer(frame, "U", diff.firstUpdateId) &&
+                DepthParser::integer(frame, "u", diff.finalUpdateId) &&
+                DepthParser::levels(frame, "b", scale, [&](const PriceLevel& level) {
+                    diff.bids.push_back(level);
+                    return true;
+                }) &&
+                DepthParser::levels(frame, "a", scale, [&](const PriceLevel& level) {
+                    diff.asks.push_back(level);
+                    return true;
+                });
+        }
+
+        // Copy of the pair's book: the last depth snapshot, kept current by
+        // the diff stream once the pair is subscribed
+        OrderBook orderBook(Token buyToken, Token sellToken) {
+            std::lock_guard<std::mutex> lock(booksMutex);
+            return bookFor(buyToken, sellToken).book;
+        }
+
+        // Pairs a bookTicker request names, larger batches ask for every symbol
+        static constexpr size_t MAX_LISTED_SYMBOLS = 64;
+
+    private:
+        // diffs kept per pair while its snapshot is on the way, ~25s of 100ms events
+        static constexpr size_t MAX_PENDING_DIFFS = 256;
+
+        // A pair's book and what keeps it in sequence with the diff stream
+        struct BookState {
+            OrderBook book;
+            // diffs streamed while a snapshot is on the way, replayed onto it
+            std::vector<BinanceDiff> pending;
+            bool resyncing = false;
+        };
+
+        // indexed by instrument id, grown as pairs show up
+        std::vector<BookState> books;
+        // subscribed pairs by the symbol their diffs carry
+        std::map<std::string, Instrument, std::less<>> depthTickers;
+        // parse scratch, guarded by booksMutex
+        BinanceDepths depths{};
+        BinanceDiff diff{};
+        std::mutex booksMutex;
+
+        // symbols the venue refused in a bookTicker list
+        std::set<std::string, std::less<>> rejectedSymbols;
+        std::mutex rejectedMutex;
+
+        // The pair's book, caller holds booksMutex
+        BookState& bookFor(Token buyToken, Token sellToken) {
+            InstrumentId id = instrumentId(buyToken, sellToken);
+            if (books.size() <= id) {
+                books.resize(id + 1);
+            }
+            return books[id];
+        }
+
+        // symbols=["BTCUSDC","ETHUSDC"], url encoded. Past a few dozen pairs
+        // the query outgrows what the venue takes on a request line, the whole
+        // market costs the same weight. A list naming one symbol the venue
+        // does not know is refused whole without saying which; the batch is
+        // then asked for unfiltered and the pairs missing from that answer are
+        // left out of later lists.
+        Task<void> fetchTickers(std::span<const Instrument> instruments, std::vector<BBO>* bbos) {
+            const std::string bookTickerUrl = this->url + "/ticker/bookTicker";
+            std::string symbols;
+            if (instruments.size() <= MAX_LISTED_SYMBOLS) {
+                std::lock_guard<std::mutex> lock(rejectedMutex);
+                for (const Instrument& pair : instruments) {
+                    const std::string& listed = symbol(pair.baseSymbol, pair.quoteSymbol);
+                    if (!rejectedSymbols.count(listed)) {
+                        symbols += (symbols.empty() ? "" : ",") + std::string("%22") + listed + "%22";
+                    }
+                }
+            }
+            const std::string tickersUrl = symbols.empty() ? bookTickerUrl : bookTickerUrl + "?symbols=%5B" + symbols + "%5D";
+            const std::map<std::string, std::string> headers = {{"Accept", "application/json"}};
+            AsyncHttp::RequestOptions options;
+            options.coalesce = true;
+            options.weight = 4;
+
+            auto res = co_await getHttp().co_get(tickersUrl, headers, options);
+            const bool refused = res.status_code == 400 && !symbols.empty();
+            if (refused) {
+                std::cerr << "[ERROR] " << this->name << " refused a symbol of the batch, asking for every book ticker: "
+                          << res.body << std::endl;
+                res = co_await getHttp().co_get(bookTickerUrl, headers, options);
+            }
+            std::string_view body = okBody(res);
+
+            timedParse(res, [&]() {
+                return readTickers(body, {"", "symbol", "bidPrice", "bidQty", "askPrice", "askQty", ""},
+                    instruments, *bbos, MarketSnapshot::nowMs());
+            });
+            stampQuotes(*bbos, res, false);
+
+            if (refused) {
+                std::lock_guard<std::mutex> lock(rejectedMutex);
+                for (size_t i = 0; i < instruments.size(); i++) {
+                    if ((*bbos)[i].timestamp == 0) {
+                        rejectedSymbols.emplace(symbol(instruments[i].baseSymbol, instruments[i].quoteSymbol));
+                    }
+                }
+            }
+        }
+
+        // Applies a streamed diff to its pair's book. Out of sequence diffs
+        // and diffs before the first snapshot start a resync: a REST snapshot
+        // is fetched and the diffs that arrive meanwhile are replayed onto it.
+        void onDepthUpdate(std::string_view frame) {
+            std::string_view ticker;
+            if (!DepthParser::string(frame, "s", ticker)) {
+                return;
+            }
+
+            Token base{}, quote{};
+            {
+                std::lock_guard<std::mutex> lock(booksMutex);
+                auto it = depthTickers.find(ticker);
+                if (it == depthTickers.end()) {
+                    return;
+                }
+                base = it->second.baseSymbol;
+                quote = it->second.quoteSymbol;
+                if (!parseDiff(frame, scaleOf(base, quote), diff)) {
+                    std::cerr << "[ERROR] Unreadable depthUpdate for " << ticker << std::endl;
+                    return;
+                }
+
+                BookState& state = bookFor(base, quote);
+                if (!state.resyncing) {
+                    auto result = state.book.applyDiff(diff.firstUpdateId, diff.finalUpdateId, diff.bids, diff.asks);
+                    if (result == OrderBook::Result::APPLIED || result == OrderBook::Result::STALE) {
+                        return;
+                    }
+                    state.resyncing = true;
+                }
+                if (state.pending.size() == MAX_PENDING_DIFFS) {
+                    state.pending.erase(state.pending.begin());
+                }
+                state.pending.push_back(diff);
+                if (state.pending.size() > 1) {
+                    // a snapshot is already on the way
+                    return;
+                }
+            }
+            // outside the lock, a rejected request completes right here
+            resync(base, quote);
+        }
+
+        // Fetches a depth snapshot for the pair and replays its pending diffs
+        // onto it, fetching again when the snapshot predates them
+        // URL, headers and options are built once per pair and kept for the
+        // gateway's lifetime, as AsyncHttp reads them until a fire completes
+        const AsyncHttp::PreparedRequest& depthRequest(Token buyToken, Token sellToken) {
+            return preparedFor(buyToken, sellToken, [&]() {
+                AsyncHttp::RequestOptions options = depthOptions();
+                // depth with the default limit of 100 levels costs 5
+                options.weight = 5;
+
+                return AsyncHttp::prepare_get(this->url + "/depth?symbol=" + symbol(buyToken, sellToken),
+                    {{"Accept", "application/json"}}, options);
+            });
+        }
+
+        void resync(Token buyToken, Token sellToken) {
+            getHttp().fire_async(depthRequest(buyToken, sellToken), [this, buyToken, sellToken](AsyncHttp::Response res) {
+                bool again = false;
+                {
+                    std::lock_guard<std::mutex> lock(booksMutex);
+                    BookState& state = bookFor(buyToken, sellToken);
+                    if (res.status_code != 200 || !parseDepths(res.body, scaleOf(buyToken, sellToken), depths)) {
+                        // the next diff tries again
+                        std::cerr << "[ERROR] Exception resyncing book for " << this->name << " details: " << res.body << std::endl;
+                        state.pending.clear();
+                        state.resyncing = false;
+                        return;
+                    }
+
+                    // a REST getBBO may have loaded a newer one meanwhile
+                    if (!state.book.synced() || depths.lastUpdateId >= state.book.lastUpdateId()) {
+                        state.book.applySnapshot(depths.lastUpdateId, depths.bids, depths.asks);
+                    }
+                    size_t replayed = 0;
+                    for (; replayed < state.pending.size(); replayed++) {
+                        const BinanceDiff& pending = state.pending[replayed];
+                        if (state.book.applyDiff(pending.firstUpdateId, pending.finalUpdateId,
+                                                 pending.bids, pending.asks) == OrderBook::Result::GAP) {
+                            break;
+                        }
+                    }
+                    state.pending.erase(state.pending.begin(), state.pending.begin() + replayed);
+                    again = !state.pending.empty();
+                    state.resyncing = again;
+                }
+                if (again) {
+                    resync(buyToken, sellToken);
+                }
+            });
+        }
+
+        // Loads the snapshot unless a newer one already got there, BBO comes off the book
+        bool applyDepths(Token buyToken, Token sellToken, std::string_view body, uint64_t timestamp, BBO& bbo) {
+            std::lock_guard<std::mutex> lock(booksMutex);
+            if (!parseDepths(body, scaleOf(buyToken, sellToken), depths)) {
+                return false;
+            }
+
+            OrderBook& book = bookFor(buyToken, sellToken).book;
+            if (!book.synced() || depths.lastUpdateId >= book.lastUpdateId()) {
+                book.applySnapshot(depths.lastUpdateId, depths.bids, depths.asks);
             }
+            bbo = book.bbo(timestamp);
+            return true;
         }
 };
@@ -1,67 +1,180 @@
 #include "common/Gateway.hpp"
 #include "common/Instrument.hpp"
 #include "common/AsyncHttp.hpp"
+#include "common/DepthParser.hpp"
 
 #include <cstdint>
 #include <exception>
+#include <stdexcept>
 #include <iostream>
+#include <memory>
 #include <map>
 #include <string>
-#include <sstream>
+#include <span>
+#include <string_view>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+// Level 1 orderbook topic, a fresh snapshot on every change
+class ByBitStreamProtocol : public StreamProtocol {
+    public:
+        std::string subscribeMessage(const std::string& ticker) override {
+            return json{
+                {"op", "subscribe"},
+                {"args", {"orderbook.1." + ticker}}
+            }.dump();
+        }
+
+        bool parse(std::string_view frame, std::string_view& ticker, WireQuote& quote) override {
+            // op replies (subscribe, pong) carry no topic
+            std::string_view topic;
+            if (!DepthParser::string(frame, "topic", topic)) {
+                return false;
+            }
+
+            // an empty side leaves the last one in place
+            if (!DepthParser::string(frame, "s", ticker) ||
+                !DepthParser::levels(frame, "b", [&](std::string_view price, std::string_view size) {
+                    quote.bidPrice = price;
+                    quote.bidSize = size;
+                    return false;
+                }) ||
+                !DepthParser::levels(frame, "a", [&](std::string_view price, std::string_view size) {
+                    quote.askPrice = price;
+                    quote.askSize = size;
+                    return false;
+                })) {
+                throw std::runtime_error("malformed orderbook frame");
+            }
+            // when the matching engine produced the update
+            DepthParser::integer(frame, "ts", quote.venueMs);
+            return true;
+        }
+
+        // Bybit drops connections that send no op ping for a while
+        std::string heartbeat() override {
+            return R"({"op":"ping"})";
+        }
+};
+
 class ByBitGateway : public Gateway {
     public:
-        ByBitGateway(std::string url = "https://api.bybit.com/v5") {
+        ByBitGateway(std::string url = "https://api.bybit.com/v5",
+                    std::string streamUrl = "wss://stream.bybit.com/v5/public/spot") {
             this->url = url;
+            this->streamUrl = streamUrl;
             this->name = Exchange::BYBIT;
+
+            // 600 requests per 5s per IP, no usage header on public endpoints
+            limitRate({480, std::chrono::seconds(5), ""});
         }
 
         std::string getTicker(Token& buyToken, Token& sellToken) override {
-            std::stringstream ss;
-            ss << buyToken << sellToken;
-            return ss.str();
+            return EnumTraits<Token>::toString(buyToken) + EnumTraits<Token>::toString(sellToken);
+        }
+
+        std::vector<Listing> listings() override {
+            return fetchListings(this->url + "/market/instruments-info?category=spot", 1, parseListings);
+        }
+
+        // Spot instruments of a /market/instruments-info answer, the whole list in one page
+        static std::vector<Listing> parseListings(std::string_view body) {
+            TokenTable& tokens = TokenTable::shared();
+            const json info = json::parse(body);
+            if (info.at("retCode") != 0) {
+                throw std::runtime_error("instruments-info: " + info.value("retMsg", std::string("no retMsg")));
+            }
+            std::vector<Listing> listings;
+
+            for (const auto& instrument : info.at("result").at("list")) {
+                listings.push_back(Listing{Exchange::BYBIT,
+                    tokens.intern(instrument.at("baseCoin").get<std::string>()),
+                    tokens.intern(instrument.at("quoteCoin").get<std::string>()),
+                    instrument.at("symbol").get<std::string>(),
+                    instrument.at("priceFilter").at("tickSize").get<std::string>(),
+                    instrument.at("lotSizeFilter").at("basePrecision").get<std::string>(),
+                    instrument.at("status") == "Trading" ? ListingStatus::TRADING : ListingStatus::HALTED});
+            }
+            return listings;
+        }
+
+        std::unique_ptr<StreamProtocol> streamProtocol() override {
+            return std::make_unique<ByBitStreamProtocol>();
         }
 
         BBO getBBO(Token buyToken, Token sellToken) override {
-            try {
-                auto& http = getHttp();
+            // Served from memory while the stream is live
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                return *bbo;
+            }
+            return sync_wait(ByBitGateway::getBBOAsync(buyToken, sellToken));
+        }
 
-                const std::string depthsUrl = this->url + "/market/orderbook?category=spot&symbol=" + getTicker(buyToken, sellToken);
-                std::map<std::string, std::string> headers = {
-                    {"Accept", "application/json"}
-                };
+        Task<BBO> getBBOAsync(Token buyToken, Token sellToken) override {
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                co_return *bbo;
+            }
 
-                auto response_future = http.get_raw(depthsUrl, headers);
-                auto res = response_future.get();
+            try {
+                // URL, headers and options are built once per pair
+                const auto& depthRequest = preparedFor(buyToken, sellToken, [&]() {
+                    return AsyncHttp::prepare_get(this->url + "/market/orderbook?category=spot&symbol=" + symbol(buyToken, sellToken),
+                        {{"Accept", "application/json"}}, depthOptions());
+                });
+
+                auto res = co_await getHttp().co_fire(depthRequest);
 
                 if (res.status_code != 200) {
                     std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << res.body << std::endl;
-                    return BBO();
+                    co_return BBO();
                 }
 
-                json data = json::parse(res.body);
                 BBO bbo;
-
-                double bidPrice = std::stod(data["result"]["b"][0][0].get<std::string>());
-                double bidSize = std::stod(data["result"]["b"][0][1].get<std::string>());
-
-                double askPrice = std::stod(data["result"]["a"][0][0].get<std::string>());
-                double askSize = std::stod(data["result"]["a"][0][1].get<std::string>());
-
-                bbo.bid = PriceLevel{bidPrice, bidSize};
-                bbo.ask = PriceLevel{askPrice, askSize};
-
-                bbo.timestamp = data["time"];
-
-                return bbo;
+                if (!timedParse(res, [&]() { return parseDepth(res.body, scaleOf(buyToken, sellToken), bbo); })) {
+                    std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: unreadable depth payload" << std::endl;
+                    co_return BBO();
+                }
+                stampQuote(bbo, res, true);
+                co_return bbo;
 
             } catch(const std::exception& e) {
                 std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << e.what() << std::endl;
-                return BBO();
+                co_return BBO();
             }
         }
 
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            return bulkBBOs(instruments,
+                [this](Token base, Token quote) { return ByBitGateway::getBBOAsync(base, quote); },
+                [this](std::span<const Instrument> pairs, std::vector<BBO>* bbos) { return fetchTickers(pairs, bbos); });
+        }
+
+        // Top of an orderbook response, stamped with the server time
+        static bool parseDepth(std::string_view body, PairScale scale, BBO& bbo) {
+            return DepthParser::top(body, "b", scale, bbo.bid) &&
+                DepthParser::top(body, "a", scale, bbo.ask) &&
+                DepthParser::integer(body, "time", bbo.timestamp);
+        }
+
+    private:
+        // Every spot ticker in one answer, the pairs asked are picked out of it
+        Task<void> fetchTickers(std::span<const Instrument> instruments, std::vector<BBO>* bbos) {
+            const std::string tickersUrl = this->url + "/market/tickers?category=spot";
+            const std::map<std::string, std::string> headers = {{"Accept", "application/json"}};
+            AsyncHttp::RequestOptions options;
+            options.coalesce = true;
+
+            auto res = co_await getHttp().co_get(tickersUrl, headers, options);
+            std::string_view body = okBody(res);
+
+            // entries carry no time of their own, the answer does
+            uint64_t timestamp = MarketSnapshot::nowMs();
+            bool venueTime = DepthParser::integer(body, "time", timestamp);
+            timedParse(res, [&]() {
+                return readTickers(body, {"list", "symbol", "bid1Price", "bid1Size", "ask1Price", "ask1Size", ""},
+                    instruments, *bbos, timestamp);
+            });
+            stampQuotes(*bbos, res, venueTime);
+        }
 };
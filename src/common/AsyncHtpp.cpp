@@ -2,6 +2,7 @@
 
 #include <nlohmann/json.hpp>
 #include <algorithm>
+#include <iterator>
 #include <cstddef>
 #include <curl/curl.h>
 #include <functional>
@@ -10,13 +11,61 @@
 #include <mutex>
 #include <stdexcept>
 #include <thread>
+#include <utility>
+
+namespace {
+
+// DNS results and TLS sessions shared by every handle in the process, so a
+// reconnect or a second gateway on the same host resumes instead of starting cold
+class SharedCache {
+    public:
+        SharedCache() : share_(curl_share_init()) {
+            curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lock);
+            curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlock);
+            curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+
+        ~SharedCache() {
+            curl_share_cleanup(share_);
+        }
+
+        CURLSH* get() const { return share_; }
+
+    private:
+        CURLSH* share_;
+        // handles on different event loops touch the cache concurrently
+        std::mutex mutexes_[CURL_LOCK_DATA_LAST];
+
+        static void lock(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+            static_cast<SharedCache*>(userptr)->mutexes_[data].lock();
+        }
+
+        static void unlock(CURL*, curl_lock_data data, void* userptr) {
+            static_cast<SharedCache*>(userptr)->mutexes_[data].unlock();
+        }
+};
+
+SharedCache& shared_cache() {
+    static SharedCache cache;
+    return cache;
+}
+
+} // namespace
 
-AsyncHttp::AsyncHttp(): multi_handle_(nullptr), running_(false) {
+AsyncHttp::AsyncHttp(): multi_handle_(nullptr), buffers_(std::make_shared<HttpBufferPool>()),
+    running_(false), queue_capacity_(256) {
     curl_global_init(CURL_GLOBAL_ALL);
 }
 
-void AsyncHttp::init(size_t pool_size) {
+void AsyncHttp::init(size_t pool_size, size_t queue_capacity) {
     multi_handle_ = curl_multi_init();
+    queue_capacity_ = queue_capacity;
+    pool_size_ = pool_size;
+
+    // a response buffer per connection, plus as many again held by callers
+    buffers_->reserve(pool_size * 2);
 
     // connection pool pre-allocation
     std::lock_guard<std::mutex> lock(pool_mutex_);
@@ -31,6 +80,7 @@ void AsyncHttp::init(size_t pool_size) {
             curl_easy_setopt(conn, CURLOPT_DNS_CACHE_TIMEOUT, 100L);
             curl_easy_setopt(conn, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
             curl_easy_setopt(conn, CURLOPT_HEADER, 0L);
+            curl_easy_setopt(conn, CURLOPT_SHARE, shared_cache().get());
 
             connection_pool_.push_back(conn);
         }
@@ -40,195 +90,750 @@ void AsyncHttp::init(size_t pool_size) {
     worker_thread_ = std::thread(&AsyncHttp::worker_loop, this);
 }
 
+size_t AsyncHttp::prewarm(const std::string& url, std::chrono::milliseconds timeout) {
+    RequestOptions options;
+    options.queue_timeout = timeout;
+    options.timeout = timeout;
+    options.connect_timeout = timeout;
+
+    // Submitted together so each one lands on its own pooled connection
+    std::vector<std::future<Response>> pending;
+    for (size_t i = 0; i < pool_size_; i++) {
+        pending.push_back(request(url, Method::HEAD, "", {}, options));
+    }
+
+    size_t warmed = 0;
+    for (auto& future : pending) {
+        // any status means DNS, connect and handshake all went through
+        if (future.get().status_code > 0) {
+            warmed++;
+        }
+    }
+    return warmed;
+}
+
 std::future<AsyncHttp::Response> AsyncHttp::get_raw(
     const std::string& url,
-    const std::map<std::string, std::string>& headers) {
-    return request(url, Method::GET, "", headers);
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options) {
+    return request(url, Method::GET, "", headers, options);
 }
 
 std::future<AsyncHttp::Response> AsyncHttp::post_raw(
     const std::string& url,
     const nlohmann::json& json_body,
-    const std::map<std::string, std::string>& headers
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
 ) {
-    std::string body = json_body.dump();
+    return request(url, Method::POST, json_body_of(json_body), json_headers_of(headers), options);
+}
 
-    auto request_headers = headers;
-    if (request_headers.find("Content-Type") == request_headers.end()) {
-        request_headers["Content-Type"] = "application/json";
-    }
+void AsyncHttp::get_async(
+    const std::string& url,
+    const std::map<std::string, std::string>& headers,
+    Callback on_complete,
+    const RequestOptions& options
+) {
+    auto transfer = make_transfer(url, Method::GET, "", headers, options);
+    transfer->on_complete = std::move(on_complete);
+    submit(std::move(transfer));
+}
+
+void AsyncHttp::post_async(
+    const std::string& url,
+    const nlohmann::json& json_body,
+    const std::map<std::string, std::string>& headers,
+    Callback on_complete,
+    const RequestOptions& options
+) {
+    auto transfer = make_transfer(url, Method::POST, json_body_of(json_body), json_headers_of(headers), options);
+    transfer->on_complete = std::move(on_complete);
+    submit(std::move(transfer));
+}
 
-    return request(url, Method::POST, body, request_headers);
+AsyncHttp::RequestAwaiter AsyncHttp::co_get(
+    const std::string& url,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
+) {
+    return RequestAwaiter(*this, make_transfer(url, Method::GET, "", headers, options));
 }
 
-template<typename T>
-std::future<T> AsyncHttp::get(const std::string& url,
-    const std::map<std::string, std::string>& headers) {
-    auto promise = std::make_shared<std::promise<T>>();
-    std::future<T> future = promise->get_future();
+AsyncHttp::RequestAwaiter AsyncHttp::co_post(
+    const std::string& url,
+    const nlohmann::json& json_body,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
+) {
+    return RequestAwaiter(*this,
+        make_transfer(url, Method::POST, json_body_of(json_body), json_headers_of(headers), options));
+}
 
-    auto response_future = get_raw(url, headers);
+AsyncHttp::PreparedRequest AsyncHttp::prepare_get(
+    const std::string& url,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
+) {
+    return PreparedRequest(Method::GET, url, "", headers, options);
+}
 
-    std::thread([promise, response_future = std::move(response_future)]() mutable {
-        try {
-            Response response = response_future.get();
-            if (response.status_code >= 200 && response.status_code < 300) {
-                T result = parse<T>(response);
-                promise->set_value(std::move(result));
-            } else {
-                std::string error_msg = "HTTP error: " + std::to_string(response.status_code);
-                if (!response.error.empty()) {
-                    error_msg += " - " + response.error;
-                } else if (!response.body.empty()) {
-                    error_msg += " - " + response.body;
-                }
-                promise->set_exception(std::make_exception_ptr(std::runtime_error(error_msg)));
-            }
-        } catch (const std::exception& e) {
-            promise->set_exception(std::current_exception());
-        }
-    }).detach();
+AsyncHttp::PreparedRequest AsyncHttp::prepare_post(
+    const std::string& url,
+    const nlohmann::json& json_body,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
+) {
+    return PreparedRequest(Method::POST, url, json_body_of(json_body), json_headers_of(headers), options);
+}
 
+std::future<AsyncHttp::Response> AsyncHttp::fire(const PreparedRequest& prepared) {
+    auto transfer = make_transfer(prepared);
+    std::future<Response> future = transfer->promise.emplace().get_future();
+    submit(std::move(transfer));
     return future;
 }
 
-template<typename T>
-std::future<T> AsyncHttp::post(const std::string& url,
-    const nlohmann::json& json_body,
-    const std::map<std::string, std::string>& headers) {
-    auto promise = std::make_shared<std::promise<T>>();
-    std::future<T> future = promise->get_future();
-
-    auto response_future = post_raw(url, json_body, headers);
-
-    std::thread([promise, response_future = std::move(response_future)]() mutable {
-        try {
-            Response response = response_future.get();
-            if (response.status_code >= 200 && response.status_code < 300) {
-                T result = parse<T>(response);
-                promise->set_value(std::move(result));
-            } else {
-                std::string error_msg = "HTTP error: " + std::to_string(response.status_code);
-                if (!response.error.empty()) {
-                    error_msg += " - " + response.error;
-                } else if (!response.body.empty()) {
-                    error_msg += " - " + response.body;
-                }
-                promise->set_exception(std::make_exception_ptr(std::runtime_error(error_msg)));
-            }
-        } catch (const std::exception& e) {
-            promise->set_exception(std::current_exception());
+void AsyncHttp::fire_async(const PreparedRequest& prepared, Callback on_complete) {
+    auto transfer = make_transfer(prepared);
+    transfer->on_complete = std::move(on_complete);
+    submit(std::move(transfer));
+}
+
+AsyncHttp::RequestAwaiter AsyncHttp::co_fire(const PreparedRequest& prepared) {
+    return RequestAwaiter(*this, make_transfer(prepared));
+}
+
+AsyncHttp::PreparedRequest::PreparedRequest(
+    Method method,
+    std::string url,
+    std::string body,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
+) : method_(method), url_(std::move(url)), body_(std::move(body)), options_(options) {
+    for (const auto& header : headers) {
+        std::string header_str = header.first + ": " + header.second;
+        headers_ = curl_slist_append(headers_, header_str.c_str());
+    }
+}
+
+AsyncHttp::PreparedRequest::~PreparedRequest() {
+    if (headers_) {
+        curl_slist_free_all(headers_);
+    }
+}
+
+AsyncHttp::PreparedRequest::PreparedRequest(PreparedRequest&& other) noexcept
+    : method_(other.method_), url_(std::move(other.url_)), body_(std::move(other.body_)),
+      headers_(std::exchange(other.headers_, nullptr)), options_(other.options_) {}
+
+AsyncHttp::PreparedRequest& AsyncHttp::PreparedRequest::operator=(PreparedRequest&& other) noexcept {
+    if (this != &other) {
+        if (headers_) {
+            curl_slist_free_all(headers_);
         }
-    }).detach();
+        method_ = other.method_;
+        url_ = std::move(other.url_);
+        body_ = std::move(other.body_);
+        headers_ = std::exchange(other.headers_, nullptr);
+        options_ = other.options_;
+    }
+    return *this;
+}
 
-    return future;
+void AsyncHttp::RequestAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    transfer_->on_complete = [this, handle](Response response) {
+        response_ = std::move(response);
+        handle.resume();
+    };
+    http_.submit(std::move(transfer_));
+}
+
+std::string AsyncHttp::json_body_of(const nlohmann::json& json_body) {
+    return json_body.dump();
+}
+
+std::map<std::string, std::string> AsyncHttp::json_headers_of(
+    const std::map<std::string, std::string>& headers
+) {
+    auto request_headers = headers;
+    if (request_headers.find("Content-Type") == request_headers.end()) {
+        request_headers["Content-Type"] = "application/json";
+    }
+    return request_headers;
 }
 
 std::future<AsyncHttp::Response> AsyncHttp::request(
     const std::string& url,
     const Method& method,
     const std::string& body,
-    const std::map<std::string, std::string>& headers
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
+) {
+    auto transfer = make_transfer(url, method, body, headers, options);
+    std::future<Response> future = transfer->promise.emplace().get_future();
+    submit(std::move(transfer));
+    return future;
+}
+
+std::unique_ptr<AsyncHttp::Transfer> AsyncHttp::make_transfer(
+    const std::string& url,
+    const Method& method,
+    const std::string& body,
+    const std::map<std::string, std::string>& headers,
+    const RequestOptions& options
 ) {
-    auto promise = std::make_shared<std::promise<Response>>();
-    std::future<Response> future = promise->get_future();
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = url;
+    transfer->method = method;
+    transfer->body = body;
+    apply_options(*transfer, options);
+
+    for (const auto& header : headers) {
+        std::string header_str = header.first + ": " + header.second;
+        transfer->headers = curl_slist_append(transfer->headers, header_str.c_str());
+    }
+
+    return transfer;
+}
 
-    std::function<void()> task = [this, url, method, body, headers, promise]() {
-        Response res;
-        CURL* conn = this->get_connection();
+std::unique_ptr<AsyncHttp::Transfer> AsyncHttp::make_transfer(const PreparedRequest& prepared) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->prepared = &prepared;
+    transfer->method = prepared.method_;
+    apply_options(*transfer, prepared.options_);
+    return transfer;
+}
 
-        if (!conn) {
-            res.status_code = -1;
-            promise->set_value(res);
+void AsyncHttp::apply_options(Transfer& transfer, const RequestOptions& options) {
+    transfer.lane = options.lane;
+    transfer.collect_headers = options.collect_headers;
+    transfer.timeout = options.timeout;
+    transfer.connect_timeout = options.connect_timeout;
+    transfer.hedge = options.hedge;
+    transfer.hedge_percentile = options.hedge_percentile;
+    transfer.weight = options.weight;
+    transfer.coalesce = options.coalesce;
+    transfer.enqueued_at = std::chrono::steady_clock::now();
+    transfer.queue_deadline = transfer.enqueued_at + options.queue_timeout;
+}
+
+void AsyncHttp::submit(std::unique_ptr<Transfer> transfer) {
+    const char* refusal = "AsyncHttp queue full";
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        // abort_all() has run or is about to, nothing would pick it up
+        if (!running_) {
+            refusal = "AsyncHttp stopped";
+        } else {
+            enqueue(transfer);
+        }
+        // under the lock, destroy() clears the handle under it too
+        if (!transfer && multi_handle_) {
+            curl_multi_wakeup(multi_handle_);
+        }
+    }
+
+    // Backpressure, the caller hears about it right away
+    if (transfer) {
+        reject(std::move(transfer), refusal);
+    }
+}
+
+void AsyncHttp::enqueue(std::unique_ptr<Transfer>& transfer) {
+    size_t lane = static_cast<size_t>(transfer->lane);
+    bool coalescable = transfer->coalesce && transfer->method == Method::GET;
+
+    if (coalescable) {
+        auto leader = coalescing_.find(url_of(*transfer));
+        // the leader must collect headers if the follower wants them
+        if (leader != coalescing_.end() &&
+            (leader->second->collect_headers || !transfer->collect_headers)) {
+            leader->second->followers.push_back(std::move(transfer));
+            coalesced_++;
             return;
         }
+    }
+
+    if (lanes_[lane].size() < queue_capacity_) {
+        lane_stats_[lane].enqueued++;
+        if (coalescable) {
+            transfer->leading = coalescing_.emplace(url_of(*transfer), transfer.get()).second;
+        }
+        lanes_[lane].push_back(std::move(transfer));
+        queued_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        lane_stats_[lane].rejected++;
+    }
+}
+
+std::string_view AsyncHttp::url_of(const Transfer& transfer) {
+    return transfer.prepared ? std::string_view(transfer.prepared->url_) : std::string_view(transfer.url);
+}
+
+uint64_t AsyncHttp::coalesced() const {
+    return coalesced_.load();
+}
+
+void AsyncHttp::reject(std::unique_ptr<Transfer> transfer, const std::string& reason) {
+    complete(transfer.release(), nullptr, CURLE_OPERATION_TIMEDOUT, reason.c_str());
+}
+
+void AsyncHttp::set_rate_limiter(std::shared_ptr<RateLimiter> limiter) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    rate_limiter_ = std::move(limiter);
+}
+
+void AsyncHttp::set_latency_recorder(std::shared_ptr<LatencyRecorder> recorder) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    latency_recorder_ = std::move(recorder);
+}
+
+std::shared_ptr<LatencyRecorder> AsyncHttp::latency_recorder() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return latency_recorder_;
+}
+
+AsyncHttp::LaneStats AsyncHttp::lane_stats(Lane lane) const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    LaneStats stats = lane_stats_[static_cast<size_t>(lane)];
+    stats.depth = lanes_[static_cast<size_t>(lane)].size();
+    return stats;
+}
+
+AsyncHttp::LoadStats AsyncHttp::load_stats() const {
+    return LoadStats{
+        queued_.load(std::memory_order_relaxed),
+        busy_.load(std::memory_order_relaxed),
+        pool_size_,
+        completed_.load(std::memory_order_relaxed),
+        failed_.load(std::memory_order_relaxed)
+    };
+}
+
+void AsyncHttp::worker_loop() {
+    while (running_) {
+        long rate_wait_ms = start_pending();
+
+        int still_running = 0;
+        curl_multi_perform(multi_handle_, &still_running);
+
+        // Freed connections can pick up queued work straight away
+        if (finish_completed() > 0) {
+            continue;
+        }
+
+        // Sleeps until a socket is ready, a timer, queue deadline, hedge or
+        // rate limit fires, or request() wakes us up
+        long timeout_ms = std::min({expire_queued(), fire_hedges(), rate_wait_ms});
+        curl_multi_poll(multi_handle_, nullptr, 0, static_cast<int>(timeout_ms), nullptr);
+    }
+
+    abort_all();
+}
 
-        curl_easy_setopt(conn, CURLOPT_URL, url.c_str());
+long AsyncHttp::start_pending() {
+    expire_queued();
 
-        struct ResponseData {
-            std::string body;
-            std::map<std::string, std::string> headers;
-        };
-        ResponseData data;
+    while (true) {
+        std::unique_ptr<Transfer> transfer;
+        CURL* conn = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            loop_limiter_ = rate_limiter_;
+            loop_latency_ = latency_recorder_;
+
+            auto lane = std::find_if(lanes_.begin(), lanes_.end(),
+                [](const auto& queue) { return !queue.empty(); });
+            if (lane == lanes_.end()) {
+                return 1000;
+            }
+
+            conn = get_connection();
+            if (!conn) {
+                // Every connection is busy, the rest waits for a completion
+                return 1000;
+            }
 
-        curl_easy_setopt(conn, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(conn, CURLOPT_WRITEDATA, &data.body);
-        curl_easy_setopt(conn, CURLOPT_HEADERFUNCTION, header_callback);
-        curl_easy_setopt(conn, CURLOPT_HEADERDATA, &data.headers);
+            // Out of budget, everything queued waits (or expires) in order
+            if (loop_limiter_) {
+                auto wait = loop_limiter_->try_acquire(lane->front()->weight);
+                if (wait.count() > 0) {
+                    return_connection(conn);
+                    return static_cast<long>(wait.count());
+                }
+            }
 
-        if (method == Method::POST) {
-            curl_easy_setopt(conn, CURLOPT_POST, 1L);
-            curl_easy_setopt(conn, CURLOPT_POSTFIELDS, body.c_str());
-            curl_easy_setopt(conn, CURLOPT_POSTFIELDSIZE, body.size());
-        } else if (method == Method::GET) {
-            curl_easy_setopt(conn, CURLOPT_HTTPGET, 1L);
+            transfer = std::move(lane->front());
+            lane->pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+
+            auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - transfer->enqueued_at).count();
+            LaneStats& stats = lane_stats_[lane - lanes_.begin()];
+            stats.dispatched++;
+            stats.total_wait_us += waited;
+            stats.max_wait_us = std::max<uint64_t>(stats.max_wait_us, waited);
         }
 
-        struct curl_slist* curl_headers = nullptr;
-        for (const auto& header : headers) {
-            std::string header_str = header.first + ": " + header.second;
-            curl_headers = curl_slist_append(curl_headers, header_str.c_str());
+        auto now = std::chrono::steady_clock::now();
+        transfer->dispatched_at = now;
+        transfer->deadline = now + transfer->timeout;
+        transfer->hedge_at = std::chrono::steady_clock::time_point::max();
+
+        // Hedge only idempotent requests, and only once there is a latency profile
+        if (transfer->hedge && transfer->method == Method::GET && latency_samples_ >= 16) {
+            transfer->hedge_at = now + latency_percentile(transfer->hedge_percentile);
         }
 
-        if (curl_headers) {
-            curl_easy_setopt(conn, CURLOPT_HTTPHEADER, curl_headers);
+        if (!launch_attempt(transfer.get(), conn)) {
+            complete(transfer.release(), nullptr, CURLE_FAILED_INIT);
+            continue;
         }
 
-        // TODO: Bad take timeout as param
-        curl_easy_setopt(conn, CURLOPT_TIMEOUT_MS, 500L);
-        curl_easy_setopt(conn, CURLOPT_CONNECTTIMEOUT_MS, 300L);
+        // Ownership moves to the loop until finish_completed()
+        in_flight_.push_back(transfer.release());
+    }
+}
 
-        CURLcode response = curl_easy_perform(conn);
+bool AsyncHttp::launch_attempt(Transfer* transfer, CURL* conn) {
+    Attempt& attempt = transfer->attempts[transfer->launched];
+    attempt.conn = conn;
+    attempt.transfer = transfer;
+    attempt.buffer = HttpBufferRef(buffers_->lease());
+    attempt.started = std::chrono::steady_clock::now();
+    HttpBufferSlot* slot = attempt.buffer.get();
+
+    const PreparedRequest* prepared = transfer->prepared;
+    const std::string& url = prepared ? prepared->url_ : transfer->url;
+    const std::string& body = prepared ? prepared->body_ : transfer->body;
+
+    curl_easy_setopt(conn, CURLOPT_URL, url.c_str());
+
+    curl_easy_setopt(conn, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(conn, CURLOPT_WRITEDATA, slot);
+    // header_callback drops every line unless the caller or the limiter wants them
+    curl_easy_setopt(conn, CURLOPT_HEADERFUNCTION, header_callback);
+    bool want_headers = transfer->collect_headers || loop_limiter_;
+    curl_easy_setopt(conn, CURLOPT_HEADERDATA, want_headers ? slot : nullptr);
+
+    // NOBODY sticks to a pooled handle, so every method sets it
+    if (transfer->method == Method::POST) {
+        curl_easy_setopt(conn, CURLOPT_NOBODY, 0L);
+        curl_easy_setopt(conn, CURLOPT_POST, 1L);
+        curl_easy_setopt(conn, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(conn, CURLOPT_POSTFIELDSIZE, body.size());
+    } else if (transfer->method == Method::GET) {
+        curl_easy_setopt(conn, CURLOPT_HTTPGET, 1L);
+        curl_easy_setopt(conn, CURLOPT_NOBODY, 0L);
+    } else if (transfer->method == Method::HEAD) {
+        curl_easy_setopt(conn, CURLOPT_NOBODY, 1L);
+    }
 
-        if (response == CURLE_OK) {
-            curl_easy_getinfo(conn, CURLINFO_RESPONSE_CODE, &res.status_code);
-            res.body = std::move(data.body);
-            res.headers = std::move(data.headers);
-        } else {
-            res.status_code = -1;
-            res.body = curl_easy_strerror(response);
+    // Always set, a pooled handle may still point at the previous request's list
+    curl_easy_setopt(conn, CURLOPT_HTTPHEADER, prepared ? prepared->headers_ : transfer->headers);
+
+    // A hedge only gets whatever is left of the transfer's budget
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        transfer->deadline - attempt.started).count();
+    curl_easy_setopt(conn, CURLOPT_TIMEOUT_MS, static_cast<long>(std::max<long long>(remaining, 1)));
+    curl_easy_setopt(conn, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(transfer->connect_timeout.count()));
+
+    curl_easy_setopt(conn, CURLOPT_PRIVATE, &attempt);
+
+    transfer->launched++;
+    if (curl_multi_add_handle(multi_handle_, conn) != CURLM_OK) {
+        release_attempt(attempt, false);
+        return false;
+    }
+
+    transfer->running++;
+    return true;
+}
+
+void AsyncHttp::release_attempt(Attempt& attempt, bool detach) {
+    if (!attempt.conn) {
+        return;
+    }
+
+    if (detach) {
+        curl_multi_remove_handle(multi_handle_, attempt.conn);
+        attempt.transfer->running--;
+    }
+
+    curl_easy_setopt(attempt.conn, CURLOPT_HTTPHEADER, nullptr);
+    curl_easy_setopt(attempt.conn, CURLOPT_PRIVATE, nullptr);
+    return_connection(attempt.conn);
+    attempt.conn = nullptr;
+    attempt.buffer.reset();
+}
+
+long AsyncHttp::fire_hedges() {
+    // Requests waiting in a lane get freed connections before any duplicate,
+    // due hedges wait for the backlog to clear
+    if (queued_.load(std::memory_order_relaxed) > 0) {
+        return 1000;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto next_hedge = now + std::chrono::milliseconds(1000);
+
+    for (Transfer* transfer : in_flight_) {
+        if (transfer->launched != 1 || transfer->running != 1) {
+            continue;
         }
 
-        if (curl_headers) {
-            curl_slist_free_all(curl_headers);
+        if (transfer->hedge_at > now) {
+            next_hedge = std::min(next_hedge, transfer->hedge_at);
+            continue;
         }
 
-        this->return_connection(conn);
+        // No spare connection, try again on the next pass
+        CURL* conn = get_connection();
+        if (!conn) {
+            break;
+        }
 
-        promise->set_value(res);
-    };
+        // Racing a duplicate is not worth spending scarce budget on
+        if (loop_limiter_ && loop_limiter_->try_acquire(transfer->weight).count() > 0) {
+            return_connection(conn);
+            transfer->hedge_at = std::chrono::steady_clock::time_point::max();
+            continue;
+        }
 
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        task_queue_.push(std::move(task));
+        if (launch_attempt(transfer, conn)) {
+            hedges_fired_++;
+        }
     }
 
-    cv_.notify_one();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(next_hedge - now).count() + 1;
+}
 
-    return future;
+void AsyncHttp::record_latency(std::chrono::steady_clock::duration elapsed) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    latency_window_[latency_samples_ % latency_window_.size()] = static_cast<uint32_t>(
+        std::min<long long>(us, UINT32_MAX));
+    latency_samples_++;
 }
 
-void AsyncHttp::worker_loop() {
-    while (running_) {
-        std::function<void()> task;
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            cv_.wait(lock, [this]() { return !task_queue_.empty() || !running_; });
+std::chrono::microseconds AsyncHttp::latency_percentile(double percentile) const {
+    size_t count = std::min(latency_samples_, latency_window_.size());
+    std::array<uint32_t, 256> sorted = latency_window_;
+    size_t rank = std::min(count - 1, static_cast<size_t>(percentile * count));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + count);
+    return std::chrono::microseconds(sorted[rank]);
+}
+
+AsyncHttp::HedgeStats AsyncHttp::hedge_stats() const {
+    return HedgeStats{hedges_fired_.load(), hedges_won_.load()};
+}
+
+size_t AsyncHttp::finish_completed() {
+    size_t completed = 0;
+    int msgs_left = 0;
+    while (CURLMsg* msg = curl_multi_info_read(multi_handle_, &msgs_left)) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        CURL* conn = msg->easy_handle;
+        CURLcode result = msg->data.result;
+
+        Attempt* attempt = nullptr;
+        curl_easy_getinfo(conn, CURLINFO_PRIVATE, &attempt);
+        Transfer* transfer = attempt->transfer;
+
+        curl_multi_remove_handle(multi_handle_, conn);
+        transfer->running--;
 
-            if (!running_ && task_queue_.empty()) {
-                break;
+        // A failed attempt with its twin still racing just steps aside
+        if (result != CURLE_OK && transfer->running > 0) {
+            release_attempt(*attempt, false);
+            completed++;
+            continue;
+        }
+
+        if (result == CURLE_OK) {
+            // a prewarm HEAD pays the cold handshake, it would skew the hedge trigger
+            if (transfer->method != Method::HEAD) {
+                record_latency(std::chrono::steady_clock::now() - attempt->started);
             }
+            if (attempt == &transfer->attempts[1]) {
+                hedges_won_++;
+            }
+        }
+
+        in_flight_.erase(std::find(in_flight_.begin(), in_flight_.end(), transfer));
+        complete(transfer, attempt, result);
+        completed++;
+    }
+
+    return completed;
+}
 
-            if (!task_queue_.empty()) {
-                task = std::move(task_queue_.front());
-                task_queue_.pop();
+void AsyncHttp::complete(Transfer* transfer, Attempt* winner, CURLcode result, const char* reason) {
+    std::unique_ptr<Transfer> owned(transfer);
+
+    Response res;
+    // kept for followers that asked for headers the leader did not need
+    HttpBufferRef buffer;
+    if (result == CURLE_OK && winner) {
+        res.received_at = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        curl_easy_getinfo(winner->conn, CURLINFO_RESPONSE_CODE, &res.status_code);
+        if (loop_limiter_) {
+            loop_limiter_->observe(res.status_code, HttpHeaders(winner->buffer));
+        }
+        if (owned->collect_headers) {
+            res.headers = HttpHeaders(winner->buffer);
+        }
+        if (loop_latency_ && owned->method != Method::HEAD) {
+            res.latency = loop_latency_->endpoint(LatencyRecorder::endpointOf(url_of(*owned), endpoint_scratch_));
+            if (res.latency) {
+                record_phases(*owned, winner->conn, *res.latency);
             }
         }
+        buffer = winner->buffer;
+        res.body = HttpBody(std::move(winner->buffer));
+    } else {
+        res.status_code = -1;
+        res.body = reason ? reason : curl_easy_strerror(result);
+    }
+
+    if (winner) {
+        release_attempt(*winner, false);
+    }
+
+    // The losing twin, if any, is still attached
+    for (size_t i = 0; i < owned->launched; i++) {
+        release_attempt(owned->attempts[i], true);
+    }
+
+    // Unregister first, a request for the URL from now on goes out fresh
+    std::vector<std::unique_ptr<Transfer>> followers;
+    if (owned->leading) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        coalescing_.erase(url_of(*owned));
+        followers = std::move(owned->followers);
+    }
+
+    // Followers share the pooled buffer, copying a response only bumps refcounts
+    for (auto& follower : followers) {
+        Response copy = res;
+        if (follower->collect_headers && buffer) {
+            copy.headers = HttpHeaders(buffer);
+        }
+        deliver(*follower, std::move(copy));
+    }
+    buffer.reset();
+
+    deliver(*owned, std::move(res));
+}
 
-        if (task) {
-            task();
+void AsyncHttp::record_phases(const Transfer& transfer, CURL* conn, EndpointLatency& latency) {
+    using Phase = EndpointLatency::Phase;
+
+    // cumulative us from the start of the attempt
+    curl_off_t dns = 0, connect = 0, tls = 0, pretransfer = 0, first_byte = 0, total = 0;
+    long connects = 0;
+    curl_easy_getinfo(conn, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(conn, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(conn, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(conn, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(conn, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(conn, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(conn, CURLINFO_NUM_CONNECTS, &connects);
+
+    uint64_t queued = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        transfer.dispatched_at - transfer.enqueued_at).count();
+    latency.record(Phase::QUEUE, queued);
+
+    // a reused connection pays none of these
+    if (connects > 0) {
+        latency.record(Phase::DNS, dns * 1000);
+        latency.record(Phase::CONNECT, std::max<curl_off_t>(connect - dns, 0) * 1000);
+        if (tls > 0) {
+            latency.record(Phase::TLS, std::max<curl_off_t>(tls - connect, 0) * 1000);
         }
     }
+
+    latency.record(Phase::TTFB, std::max<curl_off_t>(first_byte - pretransfer, 0) * 1000);
+    latency.record(Phase::TRANSFER, std::max<curl_off_t>(total - first_byte, 0) * 1000);
+    latency.record(Phase::TOTAL, queued + total * 1000);
+}
+
+void AsyncHttp::deliver(Transfer& transfer, Response response) {
+    completed_.fetch_add(1, std::memory_order_relaxed);
+    if (response.status_code < 0 || response.status_code >= 400) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (transfer.headers) {
+        curl_slist_free_all(transfer.headers);
+        transfer.headers = nullptr;
+    }
+
+    if (!transfer.on_complete) {
+        transfer.promise->set_value(std::move(response));
+        return;
+    }
+
+    // A throwing continuation must not take the event loop down
+    try {
+        transfer.on_complete(std::move(response));
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] AsyncHttp callback threw: " << e.what() << std::endl;
+    }
+}
+
+void AsyncHttp::abort_all() {
+    for (Transfer* transfer : in_flight_) {
+        complete(transfer, nullptr, CURLE_ABORTED_BY_CALLBACK);
+    }
+    in_flight_.clear();
+
+    std::vector<std::unique_ptr<Transfer>> pending;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (auto& lane : lanes_) {
+            queued_.fetch_sub(lane.size(), std::memory_order_relaxed);
+            std::move(lane.begin(), lane.end(), std::back_inserter(pending));
+            lane.clear();
+        }
+    }
+
+    for (auto& transfer : pending) {
+        complete(transfer.release(), nullptr, CURLE_ABORTED_BY_CALLBACK);
+    }
+}
+
+long AsyncHttp::expire_queued() {
+    auto now = std::chrono::steady_clock::now();
+    auto next_deadline = now + std::chrono::milliseconds(1000);
+    std::vector<std::unique_ptr<Transfer>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        for (size_t lane = 0; lane < LANE_COUNT; lane++) {
+            auto& queue = lanes_[lane];
+            for (auto it = queue.begin(); it != queue.end();) {
+                if ((*it)->queue_deadline <= now) {
+                    expired.push_back(std::move(*it));
+                    it = queue.erase(it);
+                    queued_.fetch_sub(1, std::memory_order_relaxed);
+                    lane_stats_[lane].expired++;
+                } else {
+                    next_deadline = std::min(next_deadline, (*it)->queue_deadline);
+                    ++it;
+                }
+            }
+        }
+    }
+
+    for (auto& transfer : expired) {
+        reject(std::move(transfer), "AsyncHttp queue timeout waiting for a connection");
+    }
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - now).count() + 1;
 }
 
 CURL* AsyncHttp::get_connection() {
@@ -239,12 +844,14 @@ CURL* AsyncHttp::get_connection() {
 
     CURL* conn = connection_pool_.back();
     connection_pool_.pop_back();
+    busy_.fetch_add(1, std::memory_order_relaxed);
     return conn;
 }
 
 void AsyncHttp::return_connection(CURL* conn) {
     std::lock_guard<std::mutex> lock(pool_mutex_);
     connection_pool_.push_back(conn);
+    busy_.fetch_sub(1, std::memory_order_relaxed);
 }
 
 AsyncHttp::~AsyncHttp() {
@@ -253,8 +860,14 @@ AsyncHttp::~AsyncHttp() {
 }
 
 void AsyncHttp::destroy() {
-    running_ = false;
-    cv_.notify_all();
+    {
+        // submit() sees it under the same lock, nothing queues after this
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        running_ = false;
+        if (multi_handle_) {
+            curl_multi_wakeup(multi_handle_);
+        }
+    }
 
     if (worker_thread_.joinable()) {
         worker_thread_.join();
@@ -268,48 +881,69 @@ void AsyncHttp::destroy() {
         connection_pool_.clear();
     }
 
-    if (multi_handle_) {
-        curl_multi_cleanup(multi_handle_);
-        multi_handle_ = nullptr;
+    CURLM* multi = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        std::swap(multi, multi_handle_);
+    }
+    if (multi) {
+        curl_multi_cleanup(multi);
     }
-}
-
-// Generic template
-template<typename T>
-T AsyncHttp::parse(const Response &response) {
-    throw std::runtime_error("No parser implemented for this type");
 }
 
 template<>
 nlohmann::json AsyncHttp::parse<nlohmann::json>(const Response& response) {
-    return nlohmann::json::parse(response.body);
+    return nlohmann::json::parse(response.body.view());
 }
 
 size_t AsyncHttp::write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
     size_t real_size = size * nmemb;
-    std::string* body = static_cast<std::string*>(userdata);
-    body->append(ptr, real_size);
+    auto* slot = static_cast<HttpBufferSlot*>(userdata);
+    slot->body.append(ptr, real_size);
     return real_size;
 }
 
 size_t AsyncHttp::header_callback(char* buffer, size_t size, size_t nitems, void* userdata) {
     size_t real_size = size * nitems;
-    std::string header(buffer, real_size);
-
-    auto headers = static_cast<std::map<std::string, std::string>*>(userdata);
+    auto* slot = static_cast<HttpBufferSlot*>(userdata);
+    if (!slot) {
+        return real_size;
+    }
 
-    size_t colon_pos = header.find(':');
-    if (colon_pos != std::string::npos) {
-        std::string key = header.substr(0, colon_pos);
-        std::string value = header.substr(colon_pos + 1);
+    std::string_view line(buffer, real_size);
 
-        key.erase(0, key.find_first_not_of(" \t\r\n"));
-        key.erase(key.find_last_not_of(" \t\r\n") + 1);
-        value.erase(0, value.find_first_not_of(" \t\r\n"));
-        value.erase(value.find_last_not_of(" \t\r\n") + 1);
+    // A new header block (redirect, 100-continue) replaces the previous one
+    if (line.rfind("HTTP/", 0) == 0) {
+        slot->header_data.clear();
+        slot->header_fields.clear();
+        return real_size;
+    }
 
-        (*headers)[key] = value;
+    size_t colon_pos = line.find(':');
+    if (colon_pos == std::string_view::npos) {
+        return real_size;
     }
 
+    auto trim = [](std::string_view text) {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos) {
+            return std::string_view();
+        }
+        size_t last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    };
+
+    std::string_view key = trim(line.substr(0, colon_pos));
+    std::string_view value = trim(line.substr(colon_pos + 1));
+
+    HttpBufferSlot::Field field;
+    field.name_pos = static_cast<uint32_t>(slot->header_data.size());
+    field.name_len = static_cast<uint32_t>(key.size());
+    slot->header_data.append(key);
+    field.value_pos = static_cast<uint32_t>(slot->header_data.size());
+    field.value_len = static_cast<uint32_t>(value.size());
+    slot->header_data.append(value);
+    slot->header_fields.push_back(field);
+
     return real_size;
 }
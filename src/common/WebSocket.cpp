@@ -0,0 +1,543 @@
+#include "common/WebSocket.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace {
+
+const char* WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// SHA-1 is only needed for the handshake accept key
+std::array<uint8_t, 20> sha1(std::string_view input) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string data(input);
+    uint64_t bit_len = static_cast<uint64_t>(input.size()) * 8;
+    data.push_back(static_cast<char>(0x80));
+    while (data.size() % 64 != 56) {
+        data.push_back('\0');
+    }
+    for (int i = 7; i >= 0; i--) {
+        data.push_back(static_cast<char>((bit_len >> (i * 8)) & 0xFF));
+    }
+
+    auto rotl = [](uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+
+    for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const auto* p = reinterpret_cast<const uint8_t*>(data.data() + chunk + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<uint8_t, 20> digest;
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = static_cast<uint8_t>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(h[i]);
+    }
+    return digest;
+}
+
+std::string base64(const uint8_t* data, size_t size) {
+    static const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string out;
+    out.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t chunk = uint32_t(data[i]) << 16;
+        if (i + 1 < size) chunk |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < size) chunk |= uint32_t(data[i + 2]);
+
+        out.push_back(ALPHABET[(chunk >> 18) & 0x3F]);
+        out.push_back(ALPHABET[(chunk >> 12) & 0x3F]);
+        out.push_back(i + 1 < size ? ALPHABET[(chunk >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < size ? ALPHABET[chunk & 0x3F] : '=');
+    }
+    return out;
+}
+
+std::mt19937& random_engine() {
+    thread_local std::mt19937 engine(std::random_device{}());
+    return engine;
+}
+
+// Value of a header in a raw response head, matched case-insensitively
+std::string_view header_value(std::string_view head, std::string_view name) {
+    size_t line = 0;
+    while ((line = head.find("\r\n", line)) != std::string_view::npos) {
+        line += 2;
+        std::string_view rest = head.substr(line);
+        if (rest.size() > name.size() && rest[name.size()] == ':' &&
+            std::equal(name.begin(), name.end(), rest.begin(),
+                [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) ==
+                                            std::tolower(static_cast<unsigned char>(b)); })) {
+            std::string_view value = rest.substr(name.size() + 1);
+            value = value.substr(0, value.find("\r\n"));
+            size_t first = value.find_first_not_of(' ');
+            return first == std::string_view::npos ? std::string_view() : value.substr(first);
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+WebSocketClient::WebSocketClient(std::string url) : WebSocketClient(std::move(url), Options()) {}
+
+WebSocketClient::WebSocketClient(std::string url, Options options)
+    : url_(std::move(url)), options_(std::move(options)) {
+    std::string_view rest(url_);
+    std::string scheme = "http://";
+    if (rest.rfind("wss://", 0) == 0) {
+        scheme = "https://";
+        rest.remove_prefix(6);
+    } else if (rest.rfind("ws://", 0) == 0) {
+        rest.remove_prefix(5);
+    }
+
+    size_t slash = rest.find('/');
+    host_ = std::string(rest.substr(0, slash));
+    path_ = slash == std::string_view::npos ? "/" : std::string(rest.substr(slash));
+    connect_url_ = scheme + host_ + "/";
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    if (::pipe2(wake_pipe_, O_NONBLOCK | O_CLOEXEC) != 0) {
+        wake_pipe_[0] = wake_pipe_[1] = -1;
+    }
+}
+
+WebSocketClient::~WebSocketClient() {
+    stop();
+    for (int fd : wake_pipe_) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    curl_global_cleanup();
+}
+
+void WebSocketClient::start(OpenHandler on_open, MessageHandler on_message, CloseHandler on_close) {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    on_open_ = std::move(on_open);
+    on_message_ = std::move(on_message);
+    on_close_ = std::move(on_close);
+    thread_ = std::thread(&WebSocketClient::run, this);
+}
+
+void WebSocketClient::stop() {
+    {
+        std::lock_guard<std::mutex> lock(backoff_mutex_);
+        running_ = false;
+    }
+    backoff_cv_.notify_all();
+    wake();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool WebSocketClient::send(std::string_view text) {
+    if (!connected()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        outbox_.emplace_back(text);
+    }
+    wake();
+    return true;
+}
+
+std::string WebSocketClient::accept_key(std::string_view key) {
+    std::string input(key);
+    input += WS_GUID;
+    auto digest = sha1(input);
+    return base64(digest.data(), digest.size());
+}
+
+void WebSocketClient::run() {
+    auto backoff = options_.reconnect_min;
+
+    while (running_) {
+        if (open_connection()) {
+            auto opened = std::chrono::steady_clock::now();
+            connected_.store(true, std::memory_order_release);
+            connects_++;
+
+            if (on_open_) {
+                on_open_();
+            }
+
+            read_loop();
+
+            connected_.store(false, std::memory_order_release);
+            if (on_close_) {
+                on_close_();
+            }
+
+            // Only a connection that held up resets the backoff, a server
+            // dropping us straight after the handshake still gets spaced out
+            if (std::chrono::steady_clock::now() - opened > options_.reconnect_max) {
+                backoff = options_.reconnect_min;
+            }
+        }
+
+        close_connection();
+
+        std::unique_lock<std::mutex> lock(backoff_mutex_);
+        backoff_cv_.wait_for(lock, backoff, [this]() { return !running_; });
+        backoff = std::min(backoff * 2, options_.reconnect_max);
+    }
+}
+
+bool WebSocketClient::open_connection() {
+    curl_ = curl_easy_init();
+    if (!curl_) {
+        return false;
+    }
+
+    curl_easy_setopt(curl_, CURLOPT_URL, connect_url_.c_str());
+    curl_easy_setopt(curl_, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl_, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(options_.connect_timeout.count()));
+    // ALPN must not pick h2, the upgrade below is HTTP/1.1
+    curl_easy_setopt(curl_, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+
+    CURLcode result = curl_easy_perform(curl_);
+    if (result != CURLE_OK) {
+        std::cerr << "[ERROR] WebSocket connect to " << url_ << " failed: " << curl_easy_strerror(result) << std::endl;
+        return false;
+    }
+    curl_easy_getinfo(curl_, CURLINFO_ACTIVESOCKET, &socket_);
+
+    uint8_t nonce[16];
+    for (auto& byte : nonce) {
+        byte = static_cast<uint8_t>(random_engine()());
+    }
+    std::string key = base64(nonce, sizeof(nonce));
+
+    std::string request = "GET " + path_ + " HTTP/1.1\r\n"
+                          "Host: " + host_ + "\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " + key + "\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!send_all(request)) {
+        return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + options_.connect_timeout;
+    size_t head_end;
+    while ((head_end = in_.find("\r\n\r\n")) == std::string::npos) {
+        long got = receive();
+        if (got < 0) {
+            return false;
+        }
+        if (got > 0) {
+            continue;
+        }
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        pollfd fd{socket_, POLLIN, 0};
+        if (left <= 0 || ::poll(&fd, 1, static_cast<int>(left)) <= 0) {
+            std::cerr << "[ERROR] WebSocket handshake with " << url_ << " timed out" << std::endl;
+            return false;
+        }
+    }
+
+    std::string_view head(in_.data(), head_end + 2);
+    if (head.find(" 101") == std::string_view::npos || head.find(" 101") > head.find("\r\n") ||
+        header_value(head, "Sec-WebSocket-Accept") != accept_key(key)) {
+        std::cerr << "[ERROR] WebSocket upgrade rejected by " << url_ << ": "
+                  << head.substr(0, head.find("\r\n")) << std::endl;
+        return false;
+    }
+
+    // Frames may already follow the response head
+    in_.erase(0, head_end + 4);
+    return true;
+}
+
+void WebSocketClient::close_connection() {
+    if (curl_) {
+        curl_easy_cleanup(curl_);
+        curl_ = nullptr;
+    }
+    socket_ = CURL_SOCKET_BAD;
+    in_.clear();
+    message_.clear();
+
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    outbox_.clear();
+}
+
+void WebSocketClient::read_loop() {
+    auto now = std::chrono::steady_clock::now();
+    auto last_frame = now;
+    auto next_ping = now + options_.ping_interval;
+
+    while (running_) {
+        if (!flush_outbox()) {
+            return;
+        }
+
+        // Drain whatever curl holds, TLS records may be buffered past the socket
+        long got;
+        while ((got = receive()) > 0) {
+            last_frame = std::chrono::steady_clock::now();
+        }
+        if (got < 0 || !consume_frames()) {
+            return;
+        }
+
+        now = std::chrono::steady_clock::now();
+        if (now - last_frame > options_.idle_timeout) {
+            std::cerr << "[ERROR] WebSocket " << url_ << " went quiet, reconnecting" << std::endl;
+            return;
+        }
+
+        if (now >= next_ping) {
+            if (!send_frame(PING, "") ||
+                (!options_.heartbeat.empty() && !send_frame(TEXT, options_.heartbeat))) {
+                return;
+            }
+            next_ping = now + options_.ping_interval;
+        }
+
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_ping - now).count();
+        pollfd fds[2] = {{socket_, POLLIN, 0}, {wake_pipe_[0], POLLIN, 0}};
+        ::poll(fds, wake_pipe_[0] >= 0 ? 2 : 1, static_cast<int>(std::clamp<long long>(wait, 1, 1000)));
+
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (::read(wake_pipe_[0], drain, sizeof(drain)) > 0) {}
+        }
+    }
+}
+
+bool WebSocketClient::consume_frames() {
+    size_t pos = 0;
+
+    while (in_.size() - pos >= 2) {
+        auto* p = reinterpret_cast<uint8_t*>(in_.data() + pos);
+        size_t available = in_.size() - pos;
+
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+
+        if (length == 126) {
+            if (available < 4) break;
+            length = (uint64_t(p[2]) << 8) | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (available < 10) break;
+            length = 0;
+            for (int i = 0; i < 8; i++) {
+                length = (length << 8) | p[2 + i];
+            }
+            header = 10;
+        }
+
+        size_t mask_at = header;
+        if (masked) {
+            header += 4;
+        }
+        if (available < header || available - header < length) {
+            break;
+        }
+
+        char* payload = in_.data() + pos + header;
+        // Servers must not mask, but unmasking costs nothing
+        if (masked) {
+            for (uint64_t i = 0; i < length; i++) {
+                payload[i] ^= static_cast<char>(p[mask_at + (i & 3)]);
+            }
+        }
+
+        std::string_view data(payload, length);
+        pos += header + length;
+
+        switch (opcode) {
+            case PING:
+                if (!send_frame(PONG, data)) {
+                    return false;
+                }
+                break;
+            case PONG:
+                break;
+            case CLOSE:
+                send_frame(CLOSE, data.substr(0, std::min<size_t>(data.size(), 2)));
+                in_.erase(0, pos);
+                return false;
+            case TEXT:
+            case BINARY:
+                if (fin) {
+                    if (on_message_) {
+                        on_message_(data);
+                    }
+                } else {
+                    message_.assign(data);
+                }
+                break;
+            case CONTINUATION:
+                message_.append(data);
+                if (fin) {
+                    if (on_message_) {
+                        on_message_(message_);
+                    }
+                    message_.clear();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    in_.erase(0, pos);
+    return true;
+}
+
+bool WebSocketClient::flush_outbox() {
+    std::vector<std::string> pending;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        pending.swap(outbox_);
+    }
+
+    for (const auto& text : pending) {
+        if (!send_frame(TEXT, text)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WebSocketClient::send_frame(Opcode opcode, std::string_view payload) {
+    std::string frame;
+    frame.reserve(payload.size() + 14);
+    frame.push_back(static_cast<char>(0x80 | opcode));
+
+    // Client frames are always masked
+    if (payload.size() < 126) {
+        frame.push_back(static_cast<char>(0x80 | payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        frame.push_back(static_cast<char>(0x80 | 126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size() & 0xFF));
+    } else {
+        frame.push_back(static_cast<char>(0x80 | 127));
+        for (int i = 7; i >= 0; i--) {
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> (i * 8)) & 0xFF));
+        }
+    }
+
+    uint32_t mask = random_engine()();
+    char mask_bytes[4];
+    std::memcpy(mask_bytes, &mask, sizeof(mask_bytes));
+    frame.append(mask_bytes, sizeof(mask_bytes));
+
+    for (size_t i = 0; i < payload.size(); i++) {
+        frame.push_back(payload[i] ^ mask_bytes[i & 3]);
+    }
+
+    return send_all(frame);
+}
+
+bool WebSocketClient::send_all(std::string_view data) {
+    while (!data.empty()) {
+        size_t sent = 0;
+        CURLcode result = curl_easy_send(curl_, data.data(), data.size(), &sent);
+
+        if (result == CURLE_AGAIN) {
+            pollfd fd{socket_, POLLOUT, 0};
+            if (::poll(&fd, 1, static_cast<int>(options_.connect_timeout.count())) <= 0) {
+                return false;
+            }
+            continue;
+        }
+        if (result != CURLE_OK) {
+            return false;
+        }
+        data.remove_prefix(sent);
+    }
+    return true;
+}
+
+long WebSocketClient::receive() {
+    char buffer[16384];
+    size_t received = 0;
+    CURLcode result = curl_easy_recv(curl_, buffer, sizeof(buffer), &received);
+
+    if (result == CURLE_AGAIN) {
+        return 0;
+    }
+    // zero bytes on success means the peer closed
+    if (result != CURLE_OK || received == 0) {
+        return -1;
+    }
+
+    in_.append(buffer, received);
+    return static_cast<long>(received);
+}
+
+void WebSocketClient::wake() {
+    if (wake_pipe_[1] >= 0) {
+        char byte = 1;
+        [[maybe_unused]] ssize_t ignored = ::write(wake_pipe_[1], &byte, 1);
+    }
+}
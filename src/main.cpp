@@ -4,57 +4,47 @@
 #include "bybit/ByBitGateway.cpp"
 #include "arber/arber.bot.cpp"
 #include "utils/env.hpp"
+#include "utils/MetricsServer.hpp"
 #include "utils/slack.cpp"
 #include "utils/discord.cpp"
 #include "risk/risk_calculator.hpp"
 
+#include <algorithm>
 #include <csignal>
+#include <fstream>
 
 volatile sig_atomic_t stop_flag = 0;
+volatile sig_atomic_t dump_latency_flag = 0;
+volatile sig_atomic_t export_traces_flag = 0;
 
 void signal_handler(int sig) {
     stop_flag = 1;
 }
 
+void dump_latency_handler(int) {
+    dump_latency_flag = 1;
+}
+
+void export_traces_handler(int) {
+    export_traces_flag = 1;
+}
+
 int main() {
     // Set up signal handling
     signal(SIGINT, signal_handler);
+    // kill -USR1 <pid> prints latency percentiles since the previous dump
+    signal(SIGUSR1, dump_latency_handler);
+    // kill -USR2 <pid> writes opportunity_traces.json for chrome://tracing
+    signal(SIGUSR2, export_traces_handler);
 
     ArbitrageBot* bot = new ArbitrageBot(0.005, 1);  // 0.005% min profit, 0.001 BTC trade size
     RiskCalculator riskCalc(100000.0); // Initialize with $100k
 
-    // Add exchanges with decorators
-    bot->addExchange(
-        new LatencyDecorator(
-            new LoggingDecorator(
-                new BinanceGateway()
-            )
-        )
-    );
-
-    bot->addExchange(
-        new LatencyDecorator(
-            new LoggingDecorator(
-                new ByBitGateway()
-            )
-        )
-    );
-
-    bot->addExchange(
-        new LatencyDecorator(
-            new LoggingDecorator(
-                new CoinbaseGateway()
-            )
-        )
-    );
-
-    bot->addExchange(
-        new LatencyDecorator(
-            new LoggingDecorator(
-                new OkxGateway()
-            )
-        )
-    );
+    // Add exchanges, logged and timed
+    bot->addExchange(new Instrumented<Logged<BinanceGateway>>());
+    bot->addExchange(new Instrumented<Logged<ByBitGateway>>());
+    bot->addExchange(new Instrumented<Logged<CoinbaseGateway>>());
+    bot->addExchange(new Instrumented<Logged<OkxGateway>>());
 
     const std::string slackWebhookUrl = Environment::getVar("SLACK_WEBHOOK_URL", "https://hooks.slack.com/services/...");
     auto slackObserver = std::make_unique<SlackObserver>(slackWebhookUrl);
@@ -74,10 +64,47 @@ int main() {
 
     bot->updateRiskMetrics(updatedMetrics);
 
+    // Listings come from the venues once a day and from the cache in between,
+    // SCAN_PAIRS picks what to watch: "BTC/USDC,ETH/USDT", or "*" for every
+    // pair listed on two venues
+    const auto scannable = bot->loadUniverse(Environment::getVar("INSTRUMENT_CACHE", "instruments.json"));
+    std::vector<Instrument> pairs = InstrumentUniverse::select(scannable, Environment::getVar("SCAN_PAIRS", "BTC/USDC"));
+    if (pairs.empty()) {
+        std::cerr << "[ERROR] No listed pair to scan, falling back to BTC/USDC" << std::endl;
+        pairs.emplace_back(Token::BTC, Token::USDC, Exchange::BINANCE, FeedType::SPOT);
+    }
+
+    // Quotes arrive over WebSocket from here on, REST stays as the fallback
+    for (const Instrument& pair : pairs) {
+        bot->subscribe(pair.baseSymbol, pair.quoteSymbol);
+    }
+
+    // Pay DNS, connect and TLS now rather than inside the first scans
+    bot->prewarm();
+
+    // Prometheus scrapes http://127.0.0.1:$METRICS_PORT/metrics
+    std::unique_ptr<MetricsServer> metrics;
+    try {
+        int port = std::stoi(Environment::getVar("METRICS_PORT", "9464"));
+        metrics = std::make_unique<MetricsServer>(static_cast<uint16_t>(port),
+            [&bot](std::ostream& out) { bot->writeMetrics(out); });
+        std::cout << "[INFO] Metrics on http://127.0.0.1:" << metrics->port() << "/metrics" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Metrics endpoint disabled: " << e.what() << std::endl;
+    }
+
     std::cout << "Press Ctrl+C to stop the bot" << std::endl;
 
-    std::thread bot_thread([&bot]() {
-        bot->run(Token::BTC, Token::USDC, 10);
+    // SCAN_WORKERS scans run at once, sharing the hot set and cold batches
+    size_t workers = 2;
+    try {
+        workers = std::max(1, std::stoi(Environment::getVar("SCAN_WORKERS", "2")));
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Bad SCAN_WORKERS, using " << workers << ": " << e.what() << std::endl;
+    }
+
+    std::thread bot_thread([&bot, &pairs, workers]() {
+        bot->run(pairs, 10, workers);
     });
 
     std::thread risk_thread([&bot, &riskCalc]() {
@@ -95,14 +122,29 @@ int main() {
     });
 
     while (!stop_flag) {
+        if (dump_latency_flag) {
+            dump_latency_flag = 0;
+            bot->dumpLatency(std::cout);
+        }
+        if (export_traces_flag) {
+            export_traces_flag = 0;
+            std::ofstream traces("opportunity_traces.json", std::ios::trunc);
+            bot->exportTraces(traces);
+            std::cout << "[INFO] Opportunity traces written to opportunity_traces.json" << std::endl;
+        }
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
+    // scrapes read the bot, stop them first
+    metrics.reset();
     bot->stop();
-    delete bot;
 
+    // run() and its scan workers, and the risk thread, use the bot and the
+    // gateways until they see it stopped
     bot_thread.join();
     risk_thread.join();
+    bot->shutdown();
+    delete bot;
 
     std::cout << "\nBot stopped successfully" << std::endl;
 
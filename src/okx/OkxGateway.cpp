@@ -1,68 +1,184 @@
 #include "common/Gateway.hpp"
 #include "common/Instrument.hpp"
 #include "common/AsyncHttp.hpp"
+#include "common/DepthParser.hpp"
 
 #include <cstdint>
 #include <exception>
+#include <stdexcept>
 #include <iostream>
-#include <sstream>
+#include <map>
+#include <memory>
 #include <string>
+#include <span>
+#include <string_view>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+// bbo-tbt pushes the top of book tick by tick
+class OkxStreamProtocol : public StreamProtocol {
+    public:
+        std::string subscribeMessage(const std::string& ticker) override {
+            return json{
+                {"op", "subscribe"},
+                {"args", {{{"channel", "bbo-tbt"}, {"instId", ticker}}}}
+            }.dump();
+        }
+
+        bool parse(std::string_view frame, std::string_view& ticker, WireQuote& quote) override {
+            // reply to our text ping
+            if (frame == "pong") {
+                return false;
+            }
+
+            // subscribe and error events carry no data
+            std::string_view event;
+            if (DepthParser::string(frame, "event", event)) {
+                return false;
+            }
+
+            // an empty side leaves the last one in place
+            if (!DepthParser::string(frame, "instId", ticker) ||
+                !DepthParser::levels(frame, "bids", [&](std::string_view price, std::string_view size) {
+                    quote.bidPrice = price;
+                    quote.bidSize = size;
+                    return false;
+                }) ||
+                !DepthParser::levels(frame, "asks", [&](std::string_view price, std::string_view size) {
+                    quote.askPrice = price;
+                    quote.askSize = size;
+                    return false;
+                })) {
+                throw std::runtime_error("malformed bbo-tbt frame");
+            }
+            // quoted epoch ms of the tick
+            DepthParser::integer(frame, "ts", quote.venueMs);
+            return true;
+        }
+
+        // OKX closes connections idle for 30s, a text ping keeps it open
+        std::string heartbeat() override {
+            return "ping";
+        }
+};
+
 class OkxGateway : public Gateway {
     public:
-        OkxGateway(std::string url = "https://www.okx.com/api/v5") {
+        OkxGateway(std::string url = "https://www.okx.com/api/v5",
+                    std::string streamUrl = "wss://ws.okx.com:8443/ws/v5/public") {
             this->url = url;
+            this->streamUrl = streamUrl;
             this->name = Exchange::OKX;
+
+            // market/books allows 40 requests per 2s per IP
+            limitRate({32, std::chrono::seconds(2), ""});
         }
 
         std::string getTicker(Token& buyToken, Token& sellToken) override {
-            std::stringstream ss;
-            ss << buyToken << "-" << sellToken;
-            return ss.str();
+            return EnumTraits<Token>::toString(buyToken) + "-" + EnumTraits<Token>::toString(sellToken);
+        }
+
+        std::vector<Listing> listings() override {
+            return fetchListings(this->url + "/public/instruments?instType=SPOT", 1, parseListings);
+        }
+
+        // Spot instruments of a /public/instruments answer
+        static std::vector<Listing> parseListings(std::string_view body) {
+            TokenTable& tokens = TokenTable::shared();
+            const json info = json::parse(body);
+            if (info.at("code") != "0") {
+                throw std::runtime_error("instruments: " + info.value("msg", std::string("no msg")));
+            }
+            std::vector<Listing> listings;
+
+            for (const auto& instrument : info.at("data")) {
+                listings.push_back(Listing{Exchange::OKX,
+                    tokens.intern(instrument.at("baseCcy").get<std::string>()),
+                    tokens.intern(instrument.at("quoteCcy").get<std::string>()),
+                    instrument.at("instId").get<std::string>(),
+                    instrument.at("tickSz").get<std::string>(),
+                    instrument.at("lotSz").get<std::string>(),
+                    instrument.at("state") == "live" ? ListingStatus::TRADING : ListingStatus::HALTED});
+            }
+            return listings;
+        }
+
+        std::unique_ptr<StreamProtocol> streamProtocol() override {
+            return std::make_unique<OkxStreamProtocol>();
         }
 
         BBO getBBO(Token buyToken, Token sellToken) override {
-            try {
-                auto& http = getHttp();
+            // Served from memory while the stream is live
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                return *bbo;
+            }
+            return sync_wait(OkxGateway::getBBOAsync(buyToken, sellToken));
+        }
 
-                const std::string depthsUrl = this->url + "/market/books?instId=" + getTicker(buyToken, sellToken);
-                std::map<std::string, std::string> headers = {
-                    {"Accept", "application/json"}
-                };
+        Task<BBO> getBBOAsync(Token buyToken, Token sellToken) override {
+            if (auto bbo = streamedBBO(buyToken, sellToken)) {
+                co_return *bbo;
+            }
+
+            try {
+                // URL, headers and options are built once per pair
+                const auto& depthRequest = preparedFor(buyToken, sellToken, [&]() {
+                    return AsyncHttp::prepare_get(this->url + "/market/books?instId=" + symbol(buyToken, sellToken),
+                        {{"Accept", "application/json"}}, depthOptions());
+                });
 
-                auto response_future = http.get_raw(depthsUrl, headers);
-                auto res = response_future.get();
+                auto res = co_await getHttp().co_fire(depthRequest);
 
                 if (res.status_code != 200) {
                     std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << res.body << std::endl;
-                    return BBO();
+                    co_return BBO();
                 }
 
-                json data = json::parse(res.body);
                 BBO bbo;
-
-                const auto& orderbook = data["data"][0];
-
-                double bidPrice = std::stod(orderbook["bids"][0][0].get<std::string>());
-                double bidSize = std::stod(orderbook["bids"][0][1].get<std::string>());
-
-                double askPrice = std::stod(orderbook["asks"][0][0].get<std::string>());
-                double askSize = std::stod(orderbook["asks"][0][1].get<std::string>());
-
-                bbo.bid = PriceLevel{bidPrice, bidSize};
-                bbo.ask = PriceLevel{askPrice, askSize};
-
-                bbo.timestamp = std::stoull(orderbook["ts"].get<std::string>());
-
-                return bbo;
+                if (!timedParse(res, [&]() { return parseDepth(res.body, scaleOf(buyToken, sellToken), bbo); })) {
+                    std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: unreadable depth payload" << std::endl;
+                    co_return BBO();
+                }
+                stampQuote(bbo, res, true);
+                co_return bbo;
 
             } catch(const std::exception& e) {
                 std::cerr << "[ERROR] Exception fetching BBO for " << this->name << " details: " << e.what() << std::endl;
-                return BBO();
+                co_return BBO();
             }
         }
 
+        Task<std::vector<BBO>> getBBOsAsync(std::span<const Instrument> instruments) override {
+            return bulkBBOs(instruments,
+                [this](Token base, Token quote) { return OkxGateway::getBBOAsync(base, quote); },
+                [this](std::span<const Instrument> pairs, std::vector<BBO>* bbos) { return fetchTickers(pairs, bbos); });
+        }
+
+        // Top of a books response, stamped with the book's own ts
+        static bool parseDepth(std::string_view body, PairScale scale, BBO& bbo) {
+            return DepthParser::top(body, "bids", scale, bbo.bid) &&
+                DepthParser::top(body, "asks", scale, bbo.ask) &&
+                DepthParser::integer(body, "ts", bbo.timestamp);
+        }
+
+    private:
+        // Every spot ticker in one answer, the pairs asked are picked out of it
+        Task<void> fetchTickers(std::span<const Instrument> instruments, std::vector<BBO>* bbos) {
+            const std::string tickersUrl = this->url + "/market/tickers?instType=SPOT";
+            const std::map<std::string, std::string> headers = {{"Accept", "application/json"}};
+            AsyncHttp::RequestOptions options;
+            options.coalesce = true;
+
+            auto res = co_await getHttp().co_get(tickersUrl, headers, options);
+            std::string_view body = okBody(res);
+
+            timedParse(res, [&]() {
+                return readTickers(body, {"data", "instId", "bidPx", "bidSz", "askPx", "askSz", "ts"},
+                    instruments, *bbos, MarketSnapshot::nowMs());
+            });
+            // every entry carries its own ts
+            stampQuotes(*bbos, res, true);
+        }
 };
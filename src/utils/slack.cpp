@@ -30,8 +30,8 @@ private:
            << "Sell Exchange: " << opportunity.sellExchange << "\n"
            << "Profit: " << std::fixed << std::setprecision(4) << opportunity.profit << "%\n"
            << "Amount: $" << std::fixed << std::setprecision(2) << opportunity.amount << "\n"
-           << "Buy Price: $" << opportunity.buyBBO.ask.price << "\n"
-           << "Sell Price: $" << opportunity.sellBBO.bid.price << "\n"
+           << "Buy Price: $" << opportunity.buyPrice() << "\n"
+           << "Sell Price: $" << opportunity.sellPrice() << "\n"
            << "```";
         return ss.str();
     }
@@ -58,7 +58,11 @@ public:
                 {"Content-Type", "application/json"}
             };
 
-            auto response_future = http.post_raw(webhookUrl, payload, headers);
+            // Behind market data in its lane order, and off its queue capacity
+            AsyncHttp::RequestOptions options;
+            options.lane = AsyncHttp::Lane::REFERENCE;
+
+            auto response_future = http.post_raw(webhookUrl, payload, headers, options);
             auto response = response_future.get();
 
             if (response.status_code != 200) {
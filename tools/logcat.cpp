@@ -0,0 +1,144 @@
+#include "utils/AsyncLogger.hpp"
+#include "common/InstrumentUniverse.hpp"
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// [2025-01-16 16:05:26.418931] in UTC
+static std::string stamp(uint64_t timestamp) {
+    std::time_t seconds = static_cast<std::time_t>(timestamp / 1000000000ull);
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+    char text[48];
+    size_t n = std::strftime(text, sizeof(text), "[%Y-%m-%d %H:%M:%S", &utc);
+    std::snprintf(text + n, sizeof(text) - n, ".%06llu]",
+        static_cast<unsigned long long>(timestamp % 1000000000ull / 1000));
+    return text;
+}
+
+// Token names as the file gave them, the ones it does not name come from
+// the built in table and --universe
+class TokenNames {
+    public:
+        void set(uint16_t token, std::string name) {
+            if (names_.size() <= token) {
+                names_.resize(token + 1);
+            }
+            names_[token] = std::move(name);
+        }
+
+        std::string operator()(uint16_t token) const {
+            if (token < names_.size() && !names_[token].empty()) {
+                return names_[token];
+            }
+            return EnumTraits<Token>::toString(static_cast<Token>(token));
+        }
+
+    private:
+        std::vector<std::string> names_;
+};
+
+static void render(const LogRecord& record, TokenNames& names, std::ostream& out) {
+    // names the token for the records after it, prints nothing
+    if (record.kind == LogRecord::Kind::TOKEN) {
+        names.set(record.base, AsyncLogger::tokenName(record));
+        return;
+    }
+
+    const PairScale scale{record.priceDecimals, record.sizeDecimals};
+    const Exchange venue = static_cast<Exchange>(record.venue);
+
+    out << stamp(record.timestamp) << " ";
+    switch (record.kind) {
+        case LogRecord::Kind::QUOTE:
+            out << venue << " " << names(record.base) << names(record.quote)
+                << " Bid: " << scale.price(record.values[0]) << "@" << scale.size(record.values[1])
+                << " Ask: " << scale.price(record.values[2]) << "@" << scale.size(record.values[3]);
+            break;
+        case LogRecord::Kind::LATENCY:
+            out << "[LATENCY] " << venue << " request took " << record.values[0] / 1e6 << "ms";
+            break;
+        case LogRecord::Kind::OPPORTUNITY:
+            out << "Buy: " << venue << " @ " << scale.price(record.values[0])
+                << " Sell: " << static_cast<Exchange>(record.otherVenue) << " @ " << scale.price(record.values[1])
+                << " Amount: " << std::bit_cast<double>(record.values[2])
+                << " Spread: " << scale.price(record.values[1] - record.values[0])
+                << " Profit: " << std::bit_cast<double>(record.values[3]) << " %";
+            break;
+        case LogRecord::Kind::RISK_CHECK_FAILED:
+            out << "RISK CHECK FAILED - Buy: " << venue
+                << " Sell: " << static_cast<Exchange>(record.otherVenue)
+                << " Amount: " << std::bit_cast<double>(record.values[2])
+                << " Profit: " << std::bit_cast<double>(record.values[3]) << "%";
+            break;
+        case LogRecord::Kind::SCAN:
+            out << "Scan duration: " << record.values[0] / 1e6 << "ms";
+            break;
+        default:
+            out << "unknown record kind " << static_cast<int>(record.kind);
+    }
+    out << "\n";
+}
+
+static bool decode(const char* path, std::ostream& out) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        std::cerr << "[ERROR] Cannot open " << path << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(AsyncLogger::MAGIC)];
+    unsigned char size = 0;
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        std::memcmp(magic, AsyncLogger::MAGIC, sizeof(magic)) != 0 ||
+        std::fread(&size, 1, 1, file) != 1 || size != sizeof(LogRecord)) {
+        std::cerr << "[ERROR] " << path << " is not a cexa binary log of this version" << std::endl;
+        std::fclose(file);
+        return false;
+    }
+
+    TokenNames names;
+    LogRecord record;
+    while (std::fread(&record, sizeof(record), 1, file) == 1) {
+        render(record, names, out);
+    }
+    std::fclose(file);
+    return true;
+}
+
+/**
+* Renders the binary logs AsyncLogger writes as text, one line per record,
+* in the order they were written. Tokens are named by the file itself; logs
+* written before files named their tokens need the instrument cache the bot
+* ran with for tokens past the built in ones.
+* usage: cexa_logcat [--universe instruments.json] exchange_logs-20250116.bin [more.bin ...]
+*/
+int main(int argc, char** argv) {
+    int first = 1;
+    if (argc > 2 && std::string(argv[1]) == "--universe") {
+        InstrumentUniverse universe;
+        if (!universe.load(argv[2])) {
+            std::cerr << "[ERROR] Cannot read instrument cache " << argv[2] << std::endl;
+            return 1;
+        }
+        first = 3;
+    }
+    if (argc <= first) {
+        std::cerr << "usage: " << argv[0] << " [--universe instruments.json] <log.bin> [log.bin ...]" << std::endl;
+        return 1;
+    }
+
+    // enough digits for 8 decimal fixed point
+    std::cout << std::setprecision(15);
+    bool ok = true;
+    for (int i = first; i < argc; i++) {
+        ok = decode(argv[i], std::cout) && ok;
+    }
+    return ok ? 0 : 1;
+}